@@ -52,18 +52,37 @@ static TCPClient* blankClient = new TCPClient(MAX_SOCK_NUM);
 
 SparkWebSocketServer::SparkWebSocketServer(TCPServer &tcpServer)
 {
+#ifdef STATIC_FRAME_ARENA
+    payload = frameArena.take(dataLen);
+#else
+    payload = payloadBuffer;
+    cBack = NULL;
+#endif
+    bBack = NULL;
     source = NULL;
     server = &tcpServer;
+    poller = NULL;
+    messageLength = -1;
+    closeStatus = CLOSE_NORMAL;
 }
 
 bool SparkWebSocketServer::handshake(TCPClient &client)
 {
+    // poll without waiting, reads spin until their byte arrives anyway
+    client.setPollTimeout(0);
+    // combine the response headers and small frames into one segment each
+    client.setWriteBuffering(true);
+
     // there is an empty spot
     // check request and look for websocket handshake
 #ifdef DEBUG_WS
     Serial.println("Handshake: analyzing.");
 #endif
 
+    // the request can arrive after the connection is accepted
+    unsigned long start = millis();
+    while(!client.available() && client.connected() && millis() - start < TIMEOUT);
+
     if(analyzeRequest(client)) {
         // valid WebSocket connection
         if(source != NULL)
@@ -71,148 +90,212 @@ bool SparkWebSocketServer::handshake(TCPClient &client)
 
         // keep track of new connection
         source = &client;
+        messageLength = -1;
+
+        if(poller != NULL)
+            poller->add(client);
 
 #ifdef DEBUG_WS
         Serial.println("WebSocket connection established.");
 #endif
         return true;
     } else {
+        // free the connection, the server only has a few
+        client.stop();
         return false;
     }
 }
 
-/** Disconnect client from server. */
-void SparkWebSocketServer::disconnectClient()
+/** Disconnect client from server.
+  @param status Close status code to send the client first.
+*/
+void SparkWebSocketServer::disconnectClient(uint16_t status)
 {
 #ifdef DEBUG_WS
     Serial.print("Terminating TCPClient.");
 #endif
 
-    // should send 0x8700 to server to tell it I'm quitting here.
-    source->write((uint8_t) 0x87);
-    source->write((uint8_t) 0x00);
+    // close frame carrying the status code
+    uint8_t close[4] = { 0x88, 2, (uint8_t)(status >> 8), (uint8_t)(status & 0xFF) };
+    source->write(close, sizeof(close));
 
     source->flush();
     delay(10);
     source->stop();
 
-    delete source;
+    if(poller != NULL)
+        poller->remove(*source);
+
+    // source is blankClient, which takes the next connection
     source = NULL;
 }
 
-int SparkWebSocketServer::packetHealth(char* buffer) {
-    int opcode = buffer[0] & 0xF;
-    int lengthType = buffer[1] & 127;
-    int length = (buffer[2] << 8) | buffer[3];
+/** Read one frame from a client.
+  Fragments are gathered in the payload buffer until the message is whole.
+  Control frames are consumed, and a close frame ends the connection.
 
-    if(lengthType == 126) {
-        if(length == dataLen) {
-            return 0;
-        } else {
+  @param payload Buffer of dataLen bytes to read the unmasked payload into.
+  @param client TCPClient to get the frame from.
+  @return Message length, which may be 0, NO_FRAME if no whole message was
+  waiting, or -1 if the client must be disconnected with closeStatus. The
+  rest of the stream can't be trusted after -1.
+*/
+int SparkWebSocketServer::readFrame(uint8_t *payload, TCPClient &client)
+{
+    if(!client.connected() || client.available() == 0)
+        return NO_FRAME;
+
+    int first = checkedRead(client);
+    bool fin = first & 0x80;
+    int opcode = first & 0xF;
+    int lengthByte = checkedRead(client);
+    bool masked = lengthByte & 128;
+    int length = lengthByte & 127;
+
+    if(length == 126) {
+        length = checkedRead(client) << 8;
+        length |= checkedRead(client);
+    } else if(length == 127) {
 #ifdef DEBUG_WS
-            Serial.print("Unexpected length: ");
-            Serial.println(length);
+        Serial.println("64-bit lengths not supported.");
 #endif
+        return failFrame(CLOSE_TOO_BIG);
+    }
 
-            return 1;
+    uint8_t mask[4] = { 0, 0, 0, 0 };
+
+    if(masked && client.readFully(mask, 4) < 4)
+        return failFrame(CLOSE_PROTOCOL_ERROR);
+
+    // control frames are short and whole, and may come between fragments
+    if(opcode >= 0x8) {
+        if(!fin || length > 125)
+            return failFrame(CLOSE_PROTOCOL_ERROR);
+
+        uint16_t status = CLOSE_NORMAL;
+        for(int i = 0; i < length; i++) {
+            int c = checkedRead(client);
+            if(c < 0)
+                return failFrame(CLOSE_PROTOCOL_ERROR);
+            if(i == 0)
+                status = (c ^ mask[0]) << 8;
+            else if(i == 1)
+                status |= (c ^ mask[1]) & 0xFF;
         }
-    } else {
+
+        // answer a close with a close, echoing its status
+        if(opcode == 0x8)
+            return failFrame(length >= 2 ? status : CLOSE_NORMAL);
+
+        return NO_FRAME;
+    }
+
+    // a continuation must follow a fragment, anything else must not
+    if(opcode > 0x2 || (opcode == 0) != (messageLength >= 0))
+        return failFrame(CLOSE_PROTOCOL_ERROR);
+
+    int offset = messageLength >= 0 ? messageLength : 0;
+
+    if(length > dataLen - offset) {
 #ifdef DEBUG_WS
-        Serial.print("Expected type 126 but got ");
-        Serial.println(lengthType);
+        Serial.print("Unexpected length: ");
+        Serial.println(offset + length);
 #endif
+        return failFrame(CLOSE_TOO_BIG);
+    }
+
+    // the payload is received straight into the buffer
+    if(client.readFully(payload + offset, length) < length)
+        return failFrame(CLOSE_PROTOCOL_ERROR);
 
-        return 2;
+    for(int i = 0; i < length; i++)
+        payload[offset + i] ^= mask[i % 4];
+
+    if(!fin) {
+        messageLength = offset + length;
+        return NO_FRAME;
     }
+
+    messageLength = -1;
+    return offset + length;
+}
+
+/** Note why the connection has to close, for readFrame().
+  @param status Close status code for disconnectClient().
+  @return -1
+*/
+int SparkWebSocketServer::failFrame(uint16_t status)
+{
+    closeStatus = status;
+    messageLength = -1;
+    return -1;
 }
 
+#ifndef STATIC_FRAME_ARENA
 /** Read data from client.
   @param data String to read the received data into.
   @param client TCPClient to get the data from.
 */
 bool SparkWebSocketServer::getData(String &data, TCPClient &client)
 {
-    char buffer[packetLen];
+    int length = readFrame(payload, client);
 
-    if(client.connected()) {
-        while(client.available() == 0);
-
-        for(int count = 0; client.available() > 0 && count < packetLen; count++) {
-            buffer[count] = client.read();
-        }
-
-        if(packetHealth(buffer) != 0)
-            return false;
-        /*int failCount = 0;
-        while(packetHealth(buffer) > 0) {
-            // make room
-            for(int i = 0; i < packetLen-1; i++)
-                buffer[i] = buffer[i+1];
-
-            while(client.available() == 0);
-
-            buffer[packetLen-1] = client.read();
-
-            failCount++;
-        }
+    if(length == -1 && &client == source)
+        disconnectClient(closeStatus);
 
-        if(failCount != 0)
-            Serial.println(failCount);
-        */
+    if(length < 0)
+        return false;
 
-        for(int i = 0; i < dataLen; i++) {
-            data += (char) (buffer[i+8] ^ buffer[4 + i % 4]);
-        }
+    for(int i = 0; i < length; i++) {
+        data += (char)payload[i];
     }
 
     return true;
 }
+#endif
 
 /** Read one value from a client. */
 int SparkWebSocketServer::checkedRead(TCPClient &client)
 {
-    while(!client.available());
+    while(!client.available() && client.connected());
     return client.read();
 }
 
-/** Send a string to a client. */
-void SparkWebSocketServer::sendEncodedData(char *str, TCPClient &client)
+/**
+ * Send a string to a client. The frame is built in the payload buffer,
+ * which is free again once a request has been handled, so a reply takes
+ * no stack whatever its length.
+ */
+void SparkWebSocketServer::sendEncodedData(const char *str, TCPClient &client)
 {
     int size = strlen(str);
+    int header = size > 125 ? 4 : 2;
 
     if(!client) return;
 
-    // NOTE: no support for > 16-bit sized messages
-    if(size > 125) {
-        uint8_t buffer[size+4];
-        strcpy((char*)(buffer+4), str);
-
-        buffer[0] = 0x81; // string type
-        buffer[1] = 126;
-        buffer[2] = size >> 8;
-        buffer[3] = size & 0xFF;
-
-        client.write(buffer, sizeof(buffer));
+    payload[0] = 0x81; // string type
+    if(header == 4) {
+        // NOTE: no support for > 16-bit sized messages
+        payload[1] = 126;
+        payload[2] = size >> 8;
+        payload[3] = size & 0xFF;
     } else {
-        uint8_t buffer[size+2];
-        strcpy((char*)(buffer+2), str);
-
-        buffer[0] = 0x81; // string type
-        buffer[1] = size;
+        payload[1] = size;
+    }
 
-        client.write(buffer, sizeof(buffer));
+    if(header + size <= dataLen) {
+        memcpy(payload + header, str, size); // no room for the terminator
+        client.write(payload, header + size);
+    } else {
+        client.write(payload, header);
+        client.write((const uint8_t *)str, size);
     }
 }
 
 /** Send a string to a client. */
-void SparkWebSocketServer::sendEncodedData(String str, TCPClient &client)
+void SparkWebSocketServer::sendEncodedData(const String &str, TCPClient &client)
 {
-    int size = str.length() + 1;
-    char cstr[size];
-
-    str.toCharArray(cstr, size);
-
-    sendEncodedData(cstr, client);
+    sendEncodedData(str.c_str(), client);
 }
 
 /** Send a string to a client. */
@@ -224,7 +307,7 @@ void SparkWebSocketServer::sendData(const char *str, TCPClient &client)
 }
 
 /** Send a string to a client. */
-void SparkWebSocketServer::sendData(String str, TCPClient &client)
+void SparkWebSocketServer::sendData(const String &str, TCPClient &client)
 {
     if(client && client.connected()) {
         sendEncodedData(str, client);
@@ -246,6 +329,10 @@ void SparkWebSocketServer::doIt()
     TCPClient* client = blankClient;
 
     if(source == NULL || !source->connected()) {
+        // the accepted connection replaces blankClient, which may be source
+        if(source != NULL)
+            disconnectClient();
+
         *client = server->available();
 
         if(client != NULL && client->connected()) {
@@ -274,7 +361,26 @@ void SparkWebSocketServer::doIt()
             Serial.println("Found disconnect in tick.");
 #endif
             disconnectClient();
-        } else {
+        } else if(bBack != NULL) {
+            int length = readFrame(payload, *source);
+
+            // every data message is acknowledged, empty ones included, as
+            // the sender waits for each ack before sending the next
+            if(length == -1) {
+                disconnectClient(closeStatus);
+            } else if(length >= 0) {
+                (*bBack)(payload, length);
+                lastContactTime = millis();
+
+                char *ack = (char *)frameArena.scratch(ACK_SIZE);
+                if(ack) {
+                    BufferPrint(ack, ACK_SIZE).print(length);
+                    sendData(ack, *source);
+                }
+            }
+        }
+#ifndef STATIC_FRAME_ARENA
+        else {
             String req;
             bool success = getData(req, *source);
 
@@ -298,9 +404,10 @@ void SparkWebSocketServer::doIt()
                 sendData("HB", *source);
             }*/
         }
+#endif
 
         // disconnect client on timeout
-        if(millis() - lastContactTime > TIMEOUT)
+        if(source != NULL && millis() - lastContactTime > TIMEOUT)
             disconnectClient();
     }
 }
@@ -311,53 +418,39 @@ void SparkWebSocketServer::doIt()
   */
 bool SparkWebSocketServer::analyzeRequest(TCPClient &client)
 {
-    String temp;
-
-    int bite;
+    char line[HEADER_LINE_SIZE];
+    char key[KEY_SIZE + sizeof(WEBSOCKET_GUID)];
     bool foundUpgrade = false;
-    String oldKey[2];
-    String newKey;
+    bool hixie76 = false;
+
+    key[0] = 0;
 
 #ifdef DEBUG_WS
     Serial.println("Analyzing request headers.");
 #endif
 
-    // TODO: More robust string extraction
-    while((bite = client.read()) != -1) {
-        temp += (char)bite;
-
-        // end of line?
-        if((char)bite == '\n') {
-#ifdef DEBUG_WS
-            Serial.print("Got Line: " + temp);
-#endif
-            // TODO: Should ignore case when comparing and allow 0-n whitespace after ':'. See the spec:
-            // http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html
-            if(!foundUpgrade && temp.startsWith("Upgrade: WebSocket")) {
-                foundUpgrade = true; // OK, it's a websockets handshake for sure
+    // Headers are parsed in place, up to the blank line that ends them. A
+    // line longer than the buffer is read as several lines.
+    while(true) {
+        StringView header = client.readStringUntil('\n', line, sizeof(line)).trim();
+        if(header.length() == 0) {
+            break;
+        }
 #ifdef DEBUG_WS
-                Serial.println("hixie76style not supported.");
+        Serial.print("Got Line: ");
+        Serial.println(header);
 #endif
-                disconnectClient();
-            } else if(!foundUpgrade && temp.startsWith("Upgrade: websocket")) {
-                foundUpgrade = true; // OK, it's a websockets handshake for sure
-            } else if(temp.startsWith("Origin: ")) {
-                origin = temp.substring(8, temp.length() - 2); // Don't save last CR+LF
-            } else if(temp.startsWith("Host: ")) {
-                host = temp.substring(6, temp.length() - 2); // Don't save last CR+LF
-            } else if(temp.startsWith("Sec-WebSocket-Key1: ")) {
-                oldKey[0] = temp.substring(20, temp.length() - 2); // Don't save last CR+LF
-            } else if(temp.startsWith("Sec-WebSocket-Key2: ")) {
-                oldKey[1] = temp.substring(20, temp.length() - 2); // Don't save last CR+LF
-            } else if(temp.startsWith("Sec-WebSocket-Key: ")) {
-                newKey = temp.substring(19, temp.length() - 2); // Don't save last CR+LF
-            }
-
-            temp = "";
-        }
-
-        if(!client.available()) {
-            delay(20);
+        // header names are case-insensitive and may be followed by any
+        // whitespace, see http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html
+        StringView name = header.split(':');
+        StringView value = header.trim();
+
+        if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")) {
+            foundUpgrade = true; // OK, it's a websockets handshake for sure
+        } else if(name.equalsIgnoreCase("Sec-WebSocket-Key1") || name.equalsIgnoreCase("Sec-WebSocket-Key2")) {
+            hixie76 = true;
+        } else if(name.equalsIgnoreCase("Sec-WebSocket-Key")) {
+            value.toCharArray(key, KEY_SIZE + 1);
         }
     }
 
@@ -365,28 +458,29 @@ bool SparkWebSocketServer::analyzeRequest(TCPClient &client)
         return false;
     }
 
-    temp += 0; // Terminate string
+    if(hixie76) {
+#ifdef DEBUG_WS
+        Serial.println("hixie76style not supported.");
+#endif
+        return false;
+    }
 
     // Assert that we have all headers that are needed. If so, go ahead and
     // send response headers.
     if(foundUpgrade == true) {
-        if (newKey.length() > 0) {
+        if (key[0] != 0) {
 #ifdef DEBUG_WS
-            Serial.println("!hixie76style: " + newKey);
+            Serial.print("!hixie76style: ");
+            Serial.println(key);
 #endif
             // add the magic string
-            newKey += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+            strcat(key, WEBSOCKET_GUID);
 
             uint8_t hash[100];
             char result[21];
             char b64Result[30];
 
-            //char hexstring[41];
-            unsigned char a[newKey.length()+1];
-            a[newKey.length()] = 0;
-            memcpy(a, newKey.c_str(), newKey.length());
-            sha1(a, newKey.length(), hash); // 10 is the length of the string
-            //toHexString(hash, hexstring);
+            sha1((unsigned char *)key, strlen(key), hash);
 
             for (uint8_t i = 0; i < 20; ++i) {
                 result[i] = (char)hash[i];
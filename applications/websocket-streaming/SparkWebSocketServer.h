@@ -45,9 +45,28 @@ http://tools.ietf.org/html/draft-hixie-thewebsocketprotocol-75
 
 #include "application.h"
 #include "spark_utilities.h"
+#include "frame-arena.h"
 
 #define CRLF "\r\n"
 
+// appended to the client's key before hashing it for the accept header
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+// longest request header line read at once, and the longest key kept
+#define HEADER_LINE_SIZE 128
+#define KEY_SIZE 32
+
+// longest acknowledgement, a payload length in decimal
+#define ACK_SIZE 12
+
+// returned by readFrame() when no whole data message was waiting
+#define NO_FRAME -2
+
+// status codes sent in close frames
+#define CLOSE_NORMAL 1000
+#define CLOSE_PROTOCOL_ERROR 1002
+#define CLOSE_TOO_BIG 1009
+
 #define HB_INTERVAL 2500
 #define TIMEOUT 5000
 
@@ -64,47 +83,81 @@ http://tools.ietf.org/html/draft-hixie-thewebsocketprotocol-75
  */
 typedef void (*CallBack)(String&, String&);
 
+/**
+ * binary call back function pointer.
+ * called with the unmasked payload of each data frame. the server replies
+ * with the payload length, which clients use as an acknowledgement.
+ */
+typedef void (*BinaryCallBack)(uint8_t*, int);
+
 class SparkWebSocketServer {
   public:
     SparkWebSocketServer(TCPServer &server);
 
+#ifndef STATIC_FRAME_ARENA
     void setCallBack(CallBack &callBack){
       cBack = callBack;
     }
+#endif
+
+    void setBinaryCallBack(BinaryCallBack &callBack){
+      bBack = callBack;
+    }
+
+    /**
+     * register the listening server and each connected client with a poller,
+     * so the app's single poll() is the only wait per loop.
+     */
+    void setPoller(SocketPoller &socketPoller){
+      poller = &socketPoller;
+      poller->add(*server);
+    }
 
     bool handshake(TCPClient &client);
 
+#ifndef STATIC_FRAME_ARENA
     bool getData(String &data, TCPClient &client);
+#endif
 
     void sendData(const char *str, TCPClient &client);
-    void sendData(String str, TCPClient &client);
+    void sendData(const String &str, TCPClient &client);
 
     void doIt();
 
+#ifndef STATIC_FRAME_ARENA
     CallBack cBack;
+#endif
+    BinaryCallBack bBack;
 
   private:
-    const int dataLen = 512; // minus length bytes and mask
-    const int packetLen = dataLen + 8;
+    static const int dataLen = 512; // largest accepted payload
+    uint8_t *payload;
+#ifndef STATIC_FRAME_ARENA
+    uint8_t payloadBuffer[dataLen];
+#endif
+
+    // bytes of a fragmented message received so far, -1 between messages
+    int messageLength;
+    // status to close with once readFrame() has returned -1
+    uint16_t closeStatus;
 
     unsigned long lastBeatTime;
     unsigned long lastContactTime;
     TCPServer* server;
     TCPClient* source;
-
-    String origin;
-    String host;
+    SocketPoller* poller;
 
     bool analyzeRequest(TCPClient &client);
     bool handleStream(String &data, TCPClient &client);
-    int packetHealth(char* buffer);
+    int readFrame(uint8_t *payload, TCPClient &client);
+    int failFrame(uint16_t status);
 
-    void disconnectClient(void);
+    void disconnectClient(uint16_t status = CLOSE_NORMAL);
 
     int checkedRead(TCPClient &client);
 
-    void sendEncodedData(char *str, TCPClient &client);
-    void sendEncodedData(String str, TCPClient &client);
+    void sendEncodedData(const char *str, TCPClient &client);
+    void sendEncodedData(const String &str, TCPClient &client);
 };
 
 #endif
@@ -0,0 +1,65 @@
+#include "bit-transpose.h"
+
+/** Build the lookup table used by transposeSlots.
+  The table maps each nibble of a transposed byte straight to port bits.
+
+  @param table 32 entries: 16 for the low nibble, then 16 for the high nibble.
+  @param pinMasks Port bit of each strip's pin.
+  @param count Number of strips, at most MAX_STRIPS.
+  */
+void transposeTable(uint16_t table[32], const uint16_t *pinMasks, uint8_t count)
+{
+  uint16_t masks[MAX_STRIPS];
+
+  for(int s = 0; s < MAX_STRIPS; s++)
+    masks[s] = (s < count) ? pinMasks[s] : 0;
+
+  // after transposition strip s sits in bit (7 - s)
+  for(int v = 0; v < 16; v++) {
+    uint16_t low = 0, high = 0;
+
+    for(int k = 0; k < 4; k++) {
+      if(v & (1 << k)) {
+        low |= masks[7 - k];
+        high |= masks[3 - k];
+      }
+    }
+
+    table[v] = low;
+    table[16 + v] = high;
+  }
+}
+
+/** Transpose one byte of every strip into 8 port words.
+  Uses the 8x8 bit matrix transpose from Hacker's Delight on two 32-bit
+  halves, then maps each result byte to port bits through the table.
+
+  @param words Port words for bit 7 down to bit 0.
+  @param column The byte at the current position of each strip.
+  @param table Lookup table from transposeTable.
+  */
+void transposeSlots(uint16_t words[8], const uint8_t column[MAX_STRIPS], const uint16_t table[32])
+{
+  uint32_t x, y, t;
+
+  x = ((uint32_t)column[0] << 24) | ((uint32_t)column[1] << 16) | ((uint32_t)column[2] << 8) | column[3];
+  y = ((uint32_t)column[4] << 24) | ((uint32_t)column[5] << 16) | ((uint32_t)column[6] << 8) | column[7];
+
+  t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+
+  t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+
+  t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+  y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+  x = t;
+
+  uint8_t rows[8] = {
+    (uint8_t)(x >> 24), (uint8_t)(x >> 16), (uint8_t)(x >> 8), (uint8_t)x,
+    (uint8_t)(y >> 24), (uint8_t)(y >> 16), (uint8_t)(y >> 8), (uint8_t)y
+  };
+
+  for(int b = 0; b < 8; b++)
+    words[b] = table[rows[b] & 0x0F] | table[16 + (rows[b] >> 4)];
+}
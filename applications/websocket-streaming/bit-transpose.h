@@ -0,0 +1,18 @@
+#ifndef _BIT_TRANSPOSE_H
+#define _BIT_TRANSPOSE_H
+
+#include <stdint.h>
+
+/*  Bit transposition for driving up to 8 LED strips from one GPIO port.
+
+    For each byte position, the byte of every strip is turned into 8 port
+    words, one per bit slot (MSB first). A word has a strip's pin set when
+    that strip's bit in the slot is 1, so a whole slot is one port write.
+*/
+
+#define MAX_STRIPS 8
+
+void transposeTable(uint16_t table[32], const uint16_t *pinMasks, uint8_t count);
+void transposeSlots(uint16_t words[8], const uint8_t column[MAX_STRIPS], const uint16_t table[32]);
+
+#endif
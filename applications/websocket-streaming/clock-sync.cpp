@@ -0,0 +1,147 @@
+#include "clock-sync.h"
+
+/** Construct a new, unsynchronised clock estimator.
+
+  @return A new ClockSync object.
+  */
+ClockSync::ClockSync()
+{
+  reset();
+}
+
+/** Forget all samples, e.g. when switching to a different leader. */
+void ClockSync::reset()
+{
+  this->samples = 0;
+  this->next = 0;
+  this->skewValid = false;
+  this->skew = 0;
+}
+
+/** Add the timestamps of one request/reply exchange.
+
+  @param t0 Local time the request was sent.
+  @param t1 Leader time the request was received.
+  @param t2 Leader time the reply was sent.
+  @param t3 Local time the reply was received.
+  */
+void ClockSync::addSample(uint32_t t0, uint32_t t1, uint32_t t2, uint32_t t3)
+{
+  Sample s;
+  int32_t roundTrip = t3 - t0;
+  int32_t processing = t2 - t1;
+
+  if(roundTrip < 0 || processing < 0 || processing > roundTrip)
+    return;
+
+  s.local = t0 + roundTrip / 2;
+  s.offset = ((int32_t)(t1 - t0) + (int32_t)(t2 - t3)) / 2;
+  s.delay = roundTrip - processing;
+
+  this->window[this->next] = s;
+  this->next = (this->next + 1) % SYNC_WINDOW;
+  if(this->samples < SYNC_WINDOW)
+    this->samples++;
+
+  // the exchange with the least delay has the least asymmetry error
+  Sample candidate = this->window[0];
+  for(int i = 1; i < this->samples; i++) {
+    if(this->window[i].delay < candidate.delay)
+      candidate = this->window[i];
+  }
+
+  if(this->samples == 1) {
+    this->anchor = candidate;
+  } else if((int32_t)(candidate.local - this->anchor.local) >= SKEW_INTERVAL) {
+    float measured = (float)(candidate.offset - this->anchor.offset) /
+      (int32_t)(candidate.local - this->anchor.local);
+
+    if(this->skewValid) {
+      this->skew += (measured - this->skew) / 4;
+    } else {
+      this->skew = measured;
+      this->skewValid = true;
+    }
+
+    this->anchor = candidate;
+  }
+
+  this->best = candidate;
+}
+
+/** @return True once at least one exchange has completed. */
+bool ClockSync::synced() const
+{
+  return this->samples > 0;
+}
+
+/** @return Leader minus local time, in microseconds, at the best sample. */
+int32_t ClockSync::offset() const
+{
+  return this->best.offset;
+}
+
+/** @return Network delay of the best sample, in microseconds. */
+uint32_t ClockSync::delay() const
+{
+  return this->best.delay;
+}
+
+/** @return Estimated rate difference of the leader clock, e.g. 1e-5 is 10 ppm fast. */
+float ClockSync::getSkew() const
+{
+  return this->skew;
+}
+
+/** Convert a local time into leader time. */
+uint32_t ClockSync::toLeader(uint32_t local) const
+{
+  int32_t elapsed = local - this->best.local;
+  return local + this->best.offset + (int32_t)(elapsed * this->skew);
+}
+
+/** Convert a leader time into local time. */
+uint32_t ClockSync::toLocal(uint32_t leader) const
+{
+  // invert toLeader; the skew term is small, so one refinement is exact enough
+  uint32_t local = leader - this->best.offset;
+  int32_t elapsed = local - this->best.local;
+  return local - (int32_t)(elapsed * this->skew);
+}
+
+/** Read a big endian time from a packet. */
+uint32_t readTime(const uint8_t *buffer)
+{
+  return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+    ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/** Decide when to show a frame due at a given time.
+  Checking only once per pass of the main loop would show it up to a pass
+  late, so a frame due before the next pass could end is waited for here.
+
+  @param now Current local time.
+  @param at Local time the frame is due.
+  @param passTime Longest time until the next check, in microseconds.
+
+  @return Microseconds to wait before showing the frame, 0 if it is already
+  due, or -1 if it can wait for a later pass.
+*/
+int32_t presentWait(uint32_t now, uint32_t at, uint32_t passTime)
+{
+  int32_t remaining = at - now;
+
+  if(remaining > (int32_t)passTime)
+    return -1;
+
+  return remaining > 0 ? remaining : 0;
+}
+
+/** Write a big endian time into a packet. */
+void writeTime(uint8_t *buffer, uint32_t time)
+{
+  buffer[0] = time >> 24;
+  buffer[1] = time >> 16;
+  buffer[2] = time >> 8;
+  buffer[3] = time;
+}
@@ -0,0 +1,71 @@
+#ifndef _CLOCK_SYNC_H
+#define _CLOCK_SYNC_H
+
+#include <stdint.h>
+
+/*  Clock synchronisation with a leader over UDP, on SYNC_PORT.
+    All times are microsecond counters, big endian, and wrap at 2^32.
+
+      SYNC_REQUEST   'T' t0            follower -> leader
+      SYNC_REPLY     't' t0 t1 t2      leader -> follower
+      SYNC_PRESENT   'P' seq presentAt leader -> follower
+
+    t0 is the follower's send time, t1 and t2 are the leader's receive and
+    reply times. SYNC_PRESENT asks for frame seq (see frame-assembler.h) to
+    be shown when the leader's clock reads presentAt.
+*/
+
+#define SYNC_PORT 2223
+
+#define SYNC_REQUEST 'T'
+#define SYNC_REPLY   't'
+#define SYNC_PRESENT 'P'
+
+#define SYNC_REQUEST_SIZE 5
+#define SYNC_REPLY_SIZE 13
+#define SYNC_PRESENT_SIZE 7
+
+// number of recent samples the lowest delay one is picked from
+#define SYNC_WINDOW 8
+
+// minimum time between the two estimates a skew measurement is taken from
+#define SKEW_INTERVAL 2000000
+
+/**   Estimates the offset and skew of a leader clock from request/reply
+      timestamps, NTP style.
+*/
+class ClockSync
+{
+  private:
+    struct Sample {
+      uint32_t local;     // local time at the midpoint of the exchange
+      int32_t offset;     // leader minus local
+      uint32_t delay;     // round trip minus leader processing time
+    };
+
+    Sample window[SYNC_WINDOW];
+    int samples;
+    int next;
+    Sample best;
+    Sample anchor;
+    bool skewValid;
+    float skew;         // leader ticks per local tick, minus one
+
+  public:
+    ClockSync();
+
+    void reset(void);
+    void addSample(uint32_t t0, uint32_t t1, uint32_t t2, uint32_t t3);
+    bool synced(void) const;
+    int32_t offset(void) const;
+    uint32_t delay(void) const;
+    float getSkew(void) const;
+    uint32_t toLeader(uint32_t local) const;
+    uint32_t toLocal(uint32_t leader) const;
+};
+
+uint32_t readTime(const uint8_t *buffer);
+void writeTime(uint8_t *buffer, uint32_t time);
+int32_t presentWait(uint32_t now, uint32_t at, uint32_t passTime);
+
+#endif
@@ -0,0 +1,45 @@
+#include "command-batch.h"
+
+// number of argument bytes that follow each opcode
+static const uint8_t argLengths[] = {
+  0, // OP_NOP
+  3, // OP_CLEAR
+  6, // OP_VOXEL
+  9, // OP_LINE
+  7, // OP_SPHERE
+  7, // OP_SHELL
+  9, // OP_BOX
+  5, // OP_PLANE
+  0, // OP_PRESENT
+};
+
+/** Number of argument bytes that follow an opcode.
+
+  @param op Opcode.
+
+  @return Length of the arguments, or -1 if the opcode is unknown.
+*/
+int commandLength(uint8_t op)
+{
+  return op < sizeof(argLengths) ? argLengths[op] : -1;
+}
+
+/** Check that a batch of drawing commands is well formed.
+
+  @param data Packed commands.
+  @param length Number of bytes in data.
+
+  @return Number of commands in the batch, or -1 if an opcode is unknown
+  or the last command is cut short.
+*/
+int checkCommands(const uint8_t *data, int length)
+{
+  int count = 0;
+
+  for(int i = 0; i < length; i += 1 + argLengths[data[i]], count++) {
+    if(data[i] >= sizeof(argLengths) || i + 1 + argLengths[data[i]] > length)
+      return -1;
+  }
+
+  return count;
+}
@@ -0,0 +1,30 @@
+#ifndef _COMMAND_BATCH_H
+#define _COMMAND_BATCH_H
+
+#include <stdint.h>
+
+/*  Binary drawing command stream.
+
+    A batch is a sequence of commands packed back to back. Each command is
+    an opcode byte followed by its arguments. Coordinates and radii are
+    signed bytes so that shapes may be partially outside of the cube.
+    Colors are three bytes: red, green, blue.
+
+    A batch must be shorter than PIXEL_COUNT bytes, because messages of that
+    length are raw frames.
+*/
+
+#define OP_NOP      0x00 // (no arguments)
+#define OP_CLEAR    0x01 // r g b
+#define OP_VOXEL    0x02 // x y z r g b
+#define OP_LINE     0x03 // x1 y1 z1 x2 y2 z2 r g b
+#define OP_SPHERE   0x04 // x y z radius r g b
+#define OP_SHELL    0x05 // x y z radius r g b
+#define OP_BOX      0x06 // x1 y1 z1 x2 y2 z2 r g b
+#define OP_PLANE    0x07 // axis offset r g b
+#define OP_PRESENT  0x08 // (no arguments)
+
+int commandLength(uint8_t op);
+int checkCommands(const uint8_t *data, int length);
+
+#endif
@@ -0,0 +1,61 @@
+#include "draw-commands.h"
+
+static inline Color colorAt(const uint8_t *args)
+{
+  return Color(args[0], args[1], args[2]);
+}
+
+/** Execute a batch of drawing commands.
+  The whole batch is validated before anything is drawn, so a malformed
+  batch leaves the cube untouched.
+
+  @param cube Cube to draw on.
+  @param data Packed commands.
+  @param length Number of bytes in data.
+
+  @return Number of commands executed, or -1 if the batch is malformed.
+*/
+int runCommands(Cube &cube, const uint8_t *data, int length)
+{
+  int count = 0;
+
+  if(checkCommands(data, length) < 0)
+    return -1;
+
+  for(int i = 0; i < length; count++) {
+    uint8_t op = data[i++];
+    const int8_t *a = (const int8_t*)(data + i);
+    const uint8_t *args = data + i;
+
+    switch(op) {
+      case OP_CLEAR:
+        cube.background(colorAt(args));
+        break;
+      case OP_VOXEL:
+        cube.setVoxel(a[0], a[1], a[2], colorAt(args + 3));
+        break;
+      case OP_LINE:
+        cube.line(a[0], a[1], a[2], a[3], a[4], a[5], colorAt(args + 6));
+        break;
+      case OP_SPHERE:
+        cube.sphere(a[0], a[1], a[2], a[3], colorAt(args + 4));
+        break;
+      case OP_SHELL:
+        cube.shell(a[0], a[1], a[2], a[3], colorAt(args + 4));
+        break;
+      case OP_BOX:
+        cube.box(a[0], a[1], a[2], a[3], a[4], a[5], colorAt(args + 6));
+        break;
+      case OP_PLANE:
+        cube.plane(a[0], a[1], colorAt(args + 2));
+        break;
+      case OP_PRESENT:
+        cube.show();
+        break;
+    }
+
+    i += commandLength(op);
+  }
+
+  return count;
+}
@@ -0,0 +1,9 @@
+#ifndef _DRAW_COMMANDS_H
+#define _DRAW_COMMANDS_H
+
+#include "l3d-cube.h"
+#include "command-batch.h"
+
+int runCommands(Cube &cube, const uint8_t *data, int length);
+
+#endif
@@ -0,0 +1,80 @@
+#include "frame-arena.h"
+#include "pool_alloc.h"
+
+// blocks are rounded up to keep every buffer word aligned
+#define ARENA_ALIGN(size) (((size) + 3) & ~(size_t)3)
+
+static uint8_t frameArenaStore[FRAME_ARENA_SIZE] __attribute__((aligned(4)));
+
+// constant initialized, so the constructors of other globals can take from it
+FrameArena frameArena(frameArenaStore, sizeof(frameArenaStore));
+
+/** Reserve a buffer for good.
+
+  @param size Size of the buffer in bytes.
+
+  @return The buffer, or NULL when the arena is full.
+  */
+uint8_t *FrameArena::take(size_t size)
+{
+  size = ARENA_ALIGN(size);
+  if(size > this->arenaSize - this->taken - this->scratchUsed) {
+    this->overflows++;
+    return NULL;
+  }
+
+  uint8_t *buffer = this->arena + this->taken;
+  this->taken += size;
+  return buffer;
+}
+
+/** Reserve a buffer until the next frame starts.
+
+  @param size Size of the buffer in bytes.
+
+  @return The buffer, or NULL when the arena is full.
+  */
+uint8_t *FrameArena::scratch(size_t size)
+{
+  size = ARENA_ALIGN(size);
+  if(size > this->arenaSize - this->taken - this->scratchUsed) {
+    this->overflows++;
+    return NULL;
+  }
+
+  this->scratchUsed += size;
+  if(this->scratchUsed > this->scratchPeak)
+    this->scratchPeak = this->scratchUsed;
+  return this->arena + this->arenaSize - this->scratchUsed;
+}
+
+/** Begin a frame: release the scratch buffers and note the allocation count. */
+void FrameArena::startFrame(void)
+{
+  this->scratchUsed = 0;
+  this->frameStartAllocs = pool_alloc_count();
+}
+
+/** End a frame.
+
+  @return The heap allocations made since startFrame().
+  */
+uint32_t FrameArena::endFrame(void)
+{
+  uint32_t allocs = pool_alloc_count() - this->frameStartAllocs;
+  if(allocs > 0)
+    this->heapFrames++;
+  return allocs;
+}
+
+/** Bytes handed out, for good and as scratch. */
+size_t FrameArena::used(void) const
+{
+  return this->taken + this->scratchUsed;
+}
+
+/** Bytes in the arena. */
+size_t FrameArena::size(void) const
+{
+  return this->arenaSize;
+}
@@ -0,0 +1,79 @@
+#ifndef _FRAME_ARENA_H
+#define _FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Buffers for frame handling, reserved at link time.
+
+    take() hands out buffers that last for good, from the bottom of the
+    arena. scratch() hands out buffers that last until the next frame, from
+    the top. Neither touches the heap, and startFrame()/endFrame() count the
+    heap allocations made in between, which should stay at zero.
+
+    With STATIC_FRAME_ARENA defined the LED pixels, the WebSocket payload
+    and the serial transport frame come from the arena too, and the String
+    based text callback is left out of the server, so the whole frame path
+    runs without the heap. Without it the arena holds only the scratch
+    buffers. It is on unless the build passes -DNO_STATIC_FRAME_ARENA.
+*/
+#ifndef NO_STATIC_FRAME_ARENA
+#define STATIC_FRAME_ARENA
+#endif
+
+#define FRAME_SCRATCH_SIZE 256
+
+#ifdef STATIC_FRAME_ARENA
+// 512 pixels of 3 bytes, the 512 byte payload, the serial frame with its
+// CRC and the scratch buffers
+#define FRAME_ARENA_SIZE (1536 + 512 + 516 + FRAME_SCRATCH_SIZE)
+#else
+#define FRAME_ARENA_SIZE FRAME_SCRATCH_SIZE
+#endif
+
+/**   A bump allocator over a static array. */
+class FrameArena
+{
+  private:
+    uint8_t *arena;
+    size_t arenaSize;
+    size_t taken;
+    size_t scratchUsed;
+    uint32_t frameStartAllocs;
+
+  public:
+    // statistics, for the memory report
+    size_t scratchPeak;
+    uint32_t overflows;
+    uint32_t heapFrames;
+
+    /** Construct a frame arena.
+      @param arena Buffer to hand out, word aligned.
+      @param arenaSize Size of the buffer in bytes.
+
+      @return A new FrameArena object.
+      */
+    constexpr FrameArena(uint8_t *arena, size_t arenaSize) : \
+        arena(arena),
+        arenaSize(arenaSize),
+        taken(0),
+        scratchUsed(0),
+        frameStartAllocs(0),
+        scratchPeak(0),
+        overflows(0),
+        heapFrames(0) { }
+
+    uint8_t *take(size_t size);
+    uint8_t *scratch(size_t size);
+
+    void startFrame(void);
+    uint32_t endFrame(void);
+
+    size_t used(void) const;
+    size_t size(void) const;
+};
+
+// the arena of FRAME_ARENA_SIZE bytes that the server and the cube use
+extern FrameArena frameArena;
+
+#endif
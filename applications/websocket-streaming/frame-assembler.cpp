@@ -0,0 +1,98 @@
+#include <string.h>
+#include "frame-assembler.h"
+
+/** Construct a new frame assembler.
+  @param frame Buffer that frames are assembled into.
+  @param frameSize Size of the buffer in bytes.
+
+  @return A new FrameAssembler object.
+  */
+FrameAssembler::FrameAssembler(uint8_t *frame, unsigned int frameSize) : \
+    frame(frame),
+    frameSize(frameSize),
+    started(false),
+    complete(false),
+    sequence(0),
+    fragmentCount(0),
+    receivedMask(0),
+    framesCompleted(0),
+    framesLost(0),
+    packetsLate(0),
+    packetsInvalid(0) { }
+
+/** Begin assembling a new frame, accounting for any frames skipped over. */
+void FrameAssembler::startFrame(uint16_t seq, uint8_t count)
+{
+  if(this->started) {
+    // every sequence number between the old frame and this one was lost
+    int16_t gap = seq - this->sequence;
+    if(gap > 0)
+      this->framesLost += gap - 1;
+
+    if(!this->complete)
+      this->framesLost++;
+  }
+
+  this->started = true;
+  this->complete = false;
+  this->sequence = seq;
+  this->fragmentCount = count;
+  this->receivedMask = 0;
+}
+
+/** Add a datagram to the frame being assembled.
+
+  @param packet Datagram, including its header.
+  @param length Length of the datagram in bytes.
+
+  @return True if the datagram completed a frame, which is then in the frame buffer.
+  */
+bool FrameAssembler::add(const uint8_t *packet, int length)
+{
+  if(length <= FRAGMENT_HEADER_SIZE) {
+    this->packetsInvalid++;
+    return false;
+  }
+
+  uint16_t seq = (packet[0] << 8) | packet[1];
+  uint8_t index = packet[2];
+  uint8_t count = packet[3];
+  unsigned int offset = index * FRAGMENT_SIZE;
+  unsigned int size = length - FRAGMENT_HEADER_SIZE;
+
+  if(count == 0 || count > MAX_FRAGMENTS || index >= count ||
+      size > FRAGMENT_SIZE || offset + size > this->frameSize) {
+    this->packetsInvalid++;
+    return false;
+  }
+
+  int16_t age = seq - this->sequence;
+
+  if(!this->started || age > 0 || age < -RESYNC_WINDOW) {
+    startFrame(seq, count);
+  } else if(age < 0 || this->complete) {
+    // older than the frame in progress, or a duplicate of a shown frame
+    this->packetsLate++;
+    return false;
+  } else if(count != this->fragmentCount) {
+    this->packetsInvalid++;
+    return false;
+  }
+
+  memcpy(this->frame + offset, packet + FRAGMENT_HEADER_SIZE, size);
+  this->receivedMask |= (uint32_t)1 << index;
+
+  uint32_t allFragments = (count == 32) ? 0xFFFFFFFF : ((uint32_t)1 << count) - 1;
+  if(this->receivedMask != allFragments)
+    return false;
+
+  this->complete = true;
+  this->framesCompleted++;
+  return true;
+}
+
+/** @return Sequence number of the frame most recently started. */
+uint16_t FrameAssembler::getSequence() const
+{
+  return this->sequence;
+}
@@ -0,0 +1,52 @@
+#ifndef _FRAME_ASSEMBLER_H
+#define _FRAME_ASSEMBLER_H
+
+#include <stdint.h>
+
+/*  Sequenced, fragmented frame stream for UDP.
+
+    Every datagram starts with a FRAGMENT_HEADER_SIZE byte header:
+
+      byte 0-1  frame sequence number, big endian, wraps at 65536
+      byte 2    index of this fragment within the frame
+      byte 3    number of fragments in the frame
+
+    followed by up to FRAGMENT_SIZE bytes of frame data. Fragment n holds
+    the frame bytes starting at n * FRAGMENT_SIZE.
+*/
+
+#define FRAGMENT_HEADER_SIZE 4
+#define FRAGMENT_SIZE 256
+#define MAX_FRAGMENTS 32
+
+// a sequence number this far behind the current frame means the sender restarted
+#define RESYNC_WINDOW 64
+
+/**   Reassembles frames from fragments and drops stale ones. */
+class FrameAssembler
+{
+  private:
+    uint8_t *frame;
+    unsigned int frameSize;
+    bool started;
+    bool complete;
+    uint16_t sequence;
+    uint8_t fragmentCount;
+    uint32_t receivedMask;
+
+    void startFrame(uint16_t seq, uint8_t count);
+
+  public:
+    // statistics, readable as Spark variables
+    int framesCompleted;
+    int framesLost;
+    int packetsLate;
+    int packetsInvalid;
+
+    FrameAssembler(uint8_t *frame, unsigned int frameSize);
+
+    bool add(const uint8_t *packet, int length);
+    uint16_t getSequence(void) const;
+};
+
+#endif
@@ -1,6 +1,33 @@
 #include <math.h>
 #include "l3d-cube.h"
 
+/*  Frame decoding tables, kept in flash.
+    FRAME_PALETTE maps an RRRGGGBB frame byte to a packed full-scale color,
+    frames are dimmed to the power budget as they are shown.  FRAME_ORDER
+    maps frame index z*64 + y*8 + x to strip index z*64 + x*8 + y.  */
+#define PALETTE_1(c) ((uint32_t)((((c)>>5)&7)*255/7) << 16 | (uint32_t)((((c)>>2)&7)*255/7) << 8 | ((c)&3)*85)
+#define PALETTE_4(c) PALETTE_1(c), PALETTE_1(c+1), PALETTE_1(c+2), PALETTE_1(c+3)
+#define PALETTE_16(c) PALETTE_4(c), PALETTE_4(c+4), PALETTE_4(c+8), PALETTE_4(c+12)
+#define PALETTE_64(c) PALETTE_16(c), PALETTE_16(c+16), PALETTE_16(c+32), PALETTE_16(c+48)
+
+static const uint32_t FRAME_PALETTE[256] = {
+  PALETTE_64(0), PALETTE_64(64), PALETTE_64(128), PALETTE_64(192)
+};
+
+#define ORDER_1(i) (((i) & ~63) | (((i) & 7) << 3) | (((i) >> 3) & 7))
+#define ORDER_8(i) ORDER_1(i), ORDER_1(i+1), ORDER_1(i+2), ORDER_1(i+3), \
+  ORDER_1(i+4), ORDER_1(i+5), ORDER_1(i+6), ORDER_1(i+7)
+#define ORDER_64(i) ORDER_8(i), ORDER_8(i+8), ORDER_8(i+16), ORDER_8(i+24), \
+  ORDER_8(i+32), ORDER_8(i+40), ORDER_8(i+48), ORDER_8(i+56)
+
+static const uint16_t FRAME_ORDER[PIXEL_COUNT] = {
+  ORDER_64(0), ORDER_64(64), ORDER_64(128), ORDER_64(192),
+  ORDER_64(256), ORDER_64(320), ORDER_64(384), ORDER_64(448)
+};
+
+// the cube the Spark functions and interrupt handler act on
+Cube *Cube::instance = NULL;
+
 /** Construct a new cube.
   @param s Size of one side of the cube in number of LEDs.
   @param mb Maximum brightness value. Used to prevent the LEDs from drawing too much current (which causes the colors to distort).
@@ -12,7 +39,16 @@ Cube::Cube(unsigned int s, unsigned int mb) : \
     maxBrightness(mb),
     onlinePressed(false),
     lastOnline(true),
-    strip(Adafruit_NeoPixel(PIXEL_COUNT, PIXEL_PIN, PIXEL_TYPE)) { }
+    strip(PIXEL_COUNT, PIXEL_PIN),
+    assembler(frame, PIXEL_COUNT),
+    hasLeader(false),
+    lastSyncRequest(0),
+    clockOffset(0),
+    framePending(false),
+    presentKnown(false),
+    poller(NULL),
+    powerBudget(POWER_BUDGET),
+    frameCurrent(0) { }
 
 /** Construct a new cube with default settings.
   @param s Size of one side of the cube in number of LEDs.
@@ -25,22 +61,70 @@ Cube::Cube() : \
     maxBrightness(50),
     onlinePressed(false),
     lastOnline(true),
-    strip(Adafruit_NeoPixel(PIXEL_COUNT, PIXEL_PIN, PIXEL_TYPE)) { }
+    strip(PIXEL_COUNT, PIXEL_PIN),
+    assembler(frame, PIXEL_COUNT),
+    hasLeader(false),
+    lastSyncRequest(0),
+    clockOffset(0),
+    framePending(false),
+    presentKnown(false),
+    poller(NULL),
+    powerBudget(POWER_BUDGET),
+    frameCurrent(0) { }
 
 /** Initialization of cube resources and environment. */
 void Cube::begin(void) {
   this->updateNetworkInfo();
 
+#ifdef PIXEL_PINS
+  const uint8_t pins[] = PIXEL_PINS;
+  this->strip.setPins(pins, sizeof(pins));
+#endif
+
+#ifdef PIXEL_DMA
+  this->strip.beginDMA();
+#endif
+
   // initialize Spark variables
-  int (Cube::*setPort)(String) = &Cube::setPort;
+  instance = this;
 
   Spark.variable("IPAddress", this->localIP, STRING);
   Spark.variable("MACAddress", this->macAddress, STRING);
   Spark.variable("port", &this->port, INT);
-  Spark.function("setPort", (int (*)(String)) setPort);
+  Spark.variable("framesLost", &this->assembler.framesLost, INT);
+  Spark.variable("packetsLate", &this->assembler.packetsLate, INT);
+  Spark.variable("clockOffset", &this->clockOffset, INT);
+  Spark.variable("frameCurrent", &this->frameCurrent, INT);
+  Spark.function("setPort", &Cube::setPortFunction);
+  Spark.function("setLeader", &Cube::setLeaderFunction);
+  Spark.function("setBudget", &Cube::setPowerBudgetFunction);
 
   this->initCloudButton();
+  // both only use receivePacket(), so need no receive buffer
+  this->udp.setBuffer(0);
+  this->syncUdp.setBuffer(0);
   this->udp.begin(STREAMING_PORT);
+  this->syncUdp.begin(SYNC_PORT);
+
+  if(this->poller == NULL)
+    this->setPoller(this->localPoller);
+}
+
+/** Wait on the cube's sockets with the app's other sockets.
+  The app's poll() is then the only wait per loop, and listen() just takes
+  what has arrived. Without it listen() waits itself.
+
+  @param socketPoller Poller the app calls once per loop.
+*/
+void Cube::setPoller(SocketPoller &socketPoller) {
+  if(this->poller != NULL) {
+    this->poller->remove(this->udp);
+    this->poller->remove(this->syncUdp);
+  }
+
+  this->poller = &socketPoller;
+  this->poller->add(this->udp);
+  this->poller->add(this->syncUdp);
 }
 
 /** Set a voxel at a position to a color.
@@ -53,7 +137,7 @@ void Cube::setVoxel(unsigned int x, unsigned int y, unsigned int z, Color col)
   if(x >= 0 && y >= 0 && z >= 0 &&
       x < this->size && y < this->size && z < this->size) {
     int index = (z*64) + (x*8) + y;
-    strip.setPixelColor(index, strip.Color(col.red, col.green, col.blue));
+    strip.setPixelColor(index, col.red, col.green, col.blue);
   }
 }
 
@@ -200,9 +284,12 @@ void Cube::line(Point p1, Point p2, Color col)
   */
 void Cube::sphere(int x, int y, int z, int r, Color col)
 {
-  for(int dx = -r; dx <= r; dx++) {
-    for(int dy = -r; dy <= r; dy++) {
-      for(int dz = -r; dz <= r; dz++) {
+  int last = this->size - 1;
+
+  // only the part inside the cube is visited, however large the sphere
+  for(int dx = max(-r, -x); dx <= min(r, last - x); dx++) {
+    for(int dy = max(-r, -y); dy <= min(r, last - y); dy++) {
+      for(int dz = max(-r, -z); dz <= min(r, last - z); dz++) {
         if(sqrt(dx*dx + dy*dy + dz*dz) <= r) {
           setVoxel(x + dx, y + dy, z + dz, col);
         }
@@ -232,6 +319,8 @@ void Cube::shell(int x, int y, int z, int r, Color col)
 {
   for(int i = 0; i <= 2*r; i++) {
     int dy = i - r;
+    if(y + dy < 0 || y + dy >= (int)this->size)
+      continue;
     int lr = sqrt((float)(i*(2*r-i)));
     this->emptyFlatCircle(x, y + dy, z, lr, col);
   }
@@ -248,6 +337,63 @@ void Cube::shell(Point p, int r, Color col)
   shell(p.x, p.y, p.z, r, col);
 }
 
+/** Draw a filled box.
+
+  @param x1, y1, z1 Coordinate of one corner of the box.
+  @param x2, y2, z2 Coordinate of the opposite corner of the box.
+  @param col Color of the box.
+*/
+void Cube::box(int x1, int y1, int z1, int x2, int y2, int z2, Color col)
+{
+  if(x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+  if(y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+  if(z1 > z2) { int t = z1; z1 = z2; z2 = t; }
+
+  // only the part inside the cube is visited, however large the box
+  int last = this->size - 1;
+  x1 = max(x1, 0); y1 = max(y1, 0); z1 = max(z1, 0);
+  x2 = min(x2, last); y2 = min(y2, last); z2 = min(z2, last);
+
+  for(int x = x1; x <= x2; x++)
+    for(int y = y1; y <= y2; y++)
+      for(int z = z1; z <= z2; z++)
+        setVoxel(x, y, z, col);
+}
+
+/** Draw a filled box.
+
+  @param p1 Coordinate of one corner of the box.
+  @param p2 Coordinate of the opposite corner of the box.
+  @param col Color of the box.
+*/
+void Cube::box(Point p1, Point p2, Color col)
+{
+  box(p1.x, p1.y, p1.z, p2.x, p2.y, p2.z, col);
+}
+
+/** Fill a plane perpendicular to one of the axes.
+
+  @param axis X_AXIS, Y_AXIS or Z_AXIS.
+  @param offset Position of the plane along the axis.
+  @param col Color of the plane.
+*/
+void Cube::plane(int axis, int offset, Color col)
+{
+  int last = this->size - 1;
+
+  switch(axis) {
+    case X_AXIS:
+      box(offset, 0, 0, offset, last, last, col);
+      break;
+    case Y_AXIS:
+      box(0, offset, 0, last, offset, last, col);
+      break;
+    case Z_AXIS:
+      box(0, 0, offset, last, last, offset, col);
+      break;
+  }
+}
+
 /** Draw an empty circle in the XZ plane.
   Uses the midpoint circle algorithm.
 
@@ -368,10 +514,21 @@ Color Cube::lerpColor(Color a, Color b, int val, int min, int max)
 }
 
 /** Make changes to the cube visible.
-  Causes pixel data to be written to the LED strips.
+  Causes pixel data to be written to the LED strips. Every way of drawing
+  ends here, so this is where a frame that would draw more than the power
+  budget is dimmed evenly. Later drawing builds on the dimmed pixels.
 */
 void Cube::show()
 {
+  uint8_t *pixels = strip.getPixels();
+
+  if(pixels != NULL) {
+    // the previous frame may still be going out by DMA
+    while(!strip.canShow());
+    this->frameCurrent = limitPixels(pixels, PIXEL_COUNT, this->powerBudget);
+    fprintf(stderr, "asked %d shown %lu\n", this->frameCurrent, (unsigned long)estimatePixelCurrent(pixels, PIXEL_COUNT));
+  }
+
   strip.show();
 }
 
@@ -390,8 +547,13 @@ void Cube::initCloudButton() {
   if(onlinePressed)
     Spark.connect();
 
-  void (Cube::*check)(void) = &Cube::checkCloudButton;
-  attachInterrupt(INTERNET_BUTTON, (void (*)())check, CHANGE);
+  attachInterrupt(INTERNET_BUTTON, &Cube::checkCloudButtonInterrupt, CHANGE);
+}
+
+/** Interrupt handler for the cloud switch, checks it on the cube. */
+void Cube::checkCloudButtonInterrupt() {
+  if(instance != NULL)
+    instance->checkCloudButton();
 }
 
 /** Check cloud switch hardware. */
@@ -419,12 +581,31 @@ void Cube::checkCloudButton() {
     WiFi.listen();
 }
 
-/** Listen for the start of UDP streaming. */
+/** Listen for the start of UDP streaming.
+  Accepts either a bare datagram of exactly PIXEL_COUNT bytes, or sequenced
+  fragments as described in frame-assembler.h. Only complete frames are shown.
+  Call it from loop(), as held sequenced frames are shown from here when due.
+  When a leader is set, sequenced frames are held until the time given for
+  them by a SYNC_PRESENT message (see clock-sync.h). A cube that others take
+  as leader sends them that message for each frame it completes, and shows
+  the frame at the same time. That holds to within a millisecond as long as
+  listen() is called again within SYNC_PASS_TIME.
+*/
 void Cube::listen() {
-  int32_t bytesrecv = this->udp.parsePacket();
+  this->presentFrame();
+
+  // both sockets in one wait, unless the app's poller does the waiting
+  if(this->poller == &this->localPoller)
+    this->poller->poll(POLLER_TIMEOUT);
+
+  // sync messages first, so a clock reply is timed as soon as it is read
+  this->serviceSync();
+
+  // received straight into packet, not through the UDP buffer
+  int length = this->udp.receivePacket(this->packet, sizeof(this->packet));
 
   // no data, nothing to do
-  if(bytesrecv == 0) return;
+  if(length <= 0) return;
 
   if(millis() - this->lastUpdated > 60000) {
     //update the network settings every minute
@@ -432,31 +613,179 @@ void Cube::listen() {
     this->lastUpdated = millis();
   }
 
-  if(bytesrecv == PIXEL_COUNT) {
-    char data[512];
-    this->udp.read(data, bytesrecv);
+  if(length == PIXEL_COUNT) {
+    // unsequenced, single datagram frame
+    drawFrame(this->packet);
+    this->show();
+  } else if(this->assembler.add(this->packet, length)) {
+    drawFrame(this->frame);
+    latchFrame(this->assembler.getSequence());
+  }
+}
 
-    for(unsigned int x = 0; x < this->size; x++) {
-      for(unsigned int y = 0; y < this->size; y++) {
-        for(unsigned int z = 0; z < this->size; z++) {
-          int index = z*64 + y*8 + x;
-          Color pixelColor = Color((data[index]&0xE0)>>2, (data[index]&0x1C)<<1, (data[index]&0x03)<<4);   //colors with max brightness set to 64
-          setVoxel(x, y, z, pixelColor);
-        }
-      }
-    }
+/** Decode a frame of 8-bit colors onto the cube, without showing it.
+  show() holds it to the power budget.
+
+  @param data PIXEL_COUNT bytes, one RRRGGGBB color per voxel.
+*/
+void Cube::drawFrame(const uint8_t *data) {
+  this->strip.setPixels(data, FRAME_PALETTE, PIXEL_COUNT, FRAME_ORDER);
+}
+
+/** Hold a drawn frame until its presentation time.
+  A follower waits for the leader's SYNC_PRESENT. A leader schedules the
+  frame SYNC_PRESENT_DELAY ahead and tells its followers, and a cube that is
+  neither shows the frame at once. A frame that is still waiting is replaced.
+
+  @param sequence Sequence number of the frame.
+*/
+void Cube::latchFrame(uint16_t sequence) {
+  this->framePending = true;
+  this->pendingSequence = sequence;
+  this->pendingSince = millis();
+
+  if(this->hasLeader)
+    return;
+
+  uint32_t at = micros() + SYNC_PRESENT_DELAY;
+
+  if(sendPresent(sequence, at) == 0) {
+    this->show();
+    this->framePending = false;
+    return;
   }
 
+  // the leader's clock is this cube's own
+  this->presentKnown = true;
+  this->presentSequence = sequence;
+  this->presentAt = at;
+}
+
+/** Show the held frame once it is due.
+  It is due at the time given for it by SYNC_PRESENT, or SYNC_PRESENT_TIMEOUT
+  after it was drawn if that never came, so a lost leader can't freeze the
+  cube. A frame due before the next listen() could is waited for here.
+*/
+void Cube::presentFrame() {
+  if(!this->framePending)
+    return;
+
+  bool scheduled = this->presentKnown && this->presentSequence == this->pendingSequence;
+  int32_t wait = scheduled ? presentWait(micros(), this->presentAt, SYNC_PASS_TIME) : -1;
+
+  if(wait < 0 && millis() - this->pendingSince < SYNC_PRESENT_TIMEOUT)
+    return;
+
+  if(wait > 0)
+    while((int32_t)(micros() - this->presentAt) < 0);
+
   this->show();
+  this->framePending = false;
+  this->presentKnown = false;
+}
+
+/** Remember a cube that takes this one as leader.
+  It replaces the follower seen longest ago if the table is full.
+
+  @param address, port Where the cube's clock requests come from.
+*/
+void Cube::addFollower(IPAddress address, uint16_t port) {
+  Follower *slot = &this->followers[0];
+
+  for(int i = 0; i < MAX_FOLLOWERS; i++) {
+    Follower *f = &this->followers[i];
+
+    if(f->address == address && f->port == port) {
+      slot = f;
+      break;
+    }
+    if(f->lastSeen < slot->lastSeen)
+      slot = f;
+  }
+
+  slot->address = address;
+  slot->port = port;
+  slot->lastSeen = millis();
+}
+
+/** Tell every follower when to show a frame.
+
+  @param sequence Sequence number of the frame.
+  @param at Time to show it, by this cube's clock.
+
+  @return Number of followers told.
+*/
+int Cube::sendPresent(uint16_t sequence, uint32_t at) {
+  uint8_t msg[SYNC_PRESENT_SIZE];
+  int count = 0;
+
+  msg[0] = SYNC_PRESENT;
+  msg[1] = sequence >> 8;
+  msg[2] = sequence & 0xFF;
+  writeTime(msg + 3, at);
+
+  for(int i = 0; i < MAX_FOLLOWERS; i++) {
+    Follower *f = &this->followers[i];
+
+    if(f->port == 0 || millis() - f->lastSeen >= SYNC_FOLLOWER_TIMEOUT)
+      continue;
+
+    this->syncUdp.beginPacket(f->address, f->port);
+    this->syncUdp.write(msg, SYNC_PRESENT_SIZE);
+    this->syncUdp.endPacket();
+    count++;
+  }
+
+  return count;
+}
+
+/** Answer clock requests and track the leader's clock. */
+void Cube::serviceSync() {
+  uint8_t msg[SYNC_REPLY_SIZE];
+
+  if(this->hasLeader && millis() - this->lastSyncRequest >= SYNC_INTERVAL) {
+    this->lastSyncRequest = millis();
+
+    msg[0] = SYNC_REQUEST;
+    writeTime(msg + 1, micros());
+    this->syncUdp.beginPacket(this->leader, SYNC_PORT);
+    this->syncUdp.write(msg, SYNC_REQUEST_SIZE);
+    this->syncUdp.endPacket();
+  }
+
+  int length = this->syncUdp.receivePacket(msg, sizeof(msg));
+
+  if(length > 0) {
+    uint32_t received = micros();
+
+    if(msg[0] == SYNC_REQUEST && length == SYNC_REQUEST_SIZE) {
+      // any cube can act as leader for the others
+      msg[0] = SYNC_REPLY;
+      writeTime(msg + 5, received);
+      writeTime(msg + 9, micros());
+      this->syncUdp.beginPacket(this->syncUdp.remoteIP(), this->syncUdp.remotePort());
+      this->syncUdp.write(msg, SYNC_REPLY_SIZE);
+      this->syncUdp.endPacket();
+      this->addFollower(this->syncUdp.remoteIP(), this->syncUdp.remotePort());
+    } else if(msg[0] == SYNC_REPLY && length == SYNC_REPLY_SIZE && this->hasLeader) {
+      this->clock.addSample(readTime(msg + 1), readTime(msg + 5), readTime(msg + 9), received);
+      this->clockOffset = this->clock.offset();
+    } else if(msg[0] == SYNC_PRESENT && length == SYNC_PRESENT_SIZE && this->clock.synced()) {
+      this->presentKnown = true;
+      this->presentSequence = (msg[1] << 8) | msg[2];
+      this->presentAt = this->clock.toLocal(readTime(msg + 3));
+    }
+  }
 }
 
 /** Update the cube's knowledge of its own network address. */
 void Cube::updateNetworkInfo() {
-  IPAddress myIp = WiFi.localIP();
-  sprintf(this->localIP, "%d.%d.%d.%d", myIp[0], myIp[1], myIp[2], myIp[3]);
+  BufferPrint ip(this->localIP, sizeof(this->localIP));
+  ip.print(WiFi.localIP());
   byte macAddr[6];
   WiFi.macAddress(macAddr);
-  sprintf(this->macAddress, "%02x:%02x:%02x:%02x:%02x:%02x",macAddr[5],macAddr[4],macAddr[3],macAddr[2],macAddr[1],macAddr[0]);
+  BufferPrint mac(this->macAddress, sizeof(this->macAddress));
+  mac.printf("%02x:%02x:%02x:%02x:%02x:%02x",macAddr[5],macAddr[4],macAddr[3],macAddr[2],macAddr[1],macAddr[0]);
 }
 
 /** Function to be called via Spark API for updating the streaming port number.
@@ -469,3 +798,64 @@ int Cube::setPort(String _port) {
   this->udp.begin(port);
   return port;
 }
+
+/** Function to be called via Spark API for setting the LED power budget.
+
+    @param milliamps Current the supply can deliver to the LEDs, in mA.
+*/
+int Cube::setPowerBudget(String milliamps) {
+  int budget = milliamps.toInt();
+  if(budget <= 0)
+    return -1;
+
+  this->powerBudget = budget;
+  return budget;
+}
+
+/** Spark function forwarding to setPort() on the cube. */
+int Cube::setPortFunction(String port) {
+  return instance != NULL ? instance->setPort(port) : -1;
+}
+
+/** Spark function forwarding to setLeader() on the cube. */
+int Cube::setLeaderFunction(String address) {
+  return instance != NULL ? instance->setLeader(address) : -1;
+}
+
+/** Spark function forwarding to setPowerBudget() on the cube. */
+int Cube::setPowerBudgetFunction(String milliamps) {
+  return instance != NULL ? instance->setPowerBudget(milliamps) : -1;
+}
+
+/** Function to be called via Spark API for choosing the clock sync leader.
+    Frames are presented at the leader's timestamps once its clock is known.
+
+    @param address Dotted IPv4 address of the leader, or "0.0.0.0" to stop syncing.
+*/
+int Cube::setLeader(String address) {
+  uint8_t octets[4];
+  int start = 0;
+
+  for(int i = 0; i < 4; i++) {
+    int end = address.indexOf('.', start);
+    if(end < 0)
+      end = address.length();
+
+    octets[i] = address.substring(start, end).toInt();
+    start = end + 1;
+  }
+
+  this->leader = IPAddress(octets[0], octets[1], octets[2], octets[3]);
+  this->hasLeader = octets[0] | octets[1] | octets[2] | octets[3];
+  this->clock.reset();
+  this->lastSyncRequest = millis() - SYNC_INTERVAL;
+
+  // nothing will schedule a held frame any more
+  if(this->framePending)
+    this->show();
+
+  this->framePending = false;
+  this->presentKnown = false;
+
+  return this->hasLeader;
+}
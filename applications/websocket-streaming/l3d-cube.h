@@ -3,16 +3,52 @@
 
 #include "application.h"
 #include "neopixel.h"
+#include "frame-assembler.h"
+#include "power-budget.h"
+#include "clock-sync.h"
 
 #define PIXEL_COUNT 512
 #define PIXEL_PIN D0
 #define PIXEL_TYPE WS2812B
 
+// to drive the LEDs as parallel strips of PIXEL_COUNT / n pixels each, list
+// one pin per strip; all must be on the same GPIO port (see setPins)
+//#define PIXEL_PINS { D0, D1, A6, A7 }
+
+// send frames with timer+DMA so show() returns at once (see beginDMA)
+//#define PIXEL_DMA
+
 #define INTERNET_BUTTON D2
 #define MODE D3
 
 #define STREAMING_PORT 2222
 
+// supply current available to the LEDs, frames that would draw more are dimmed
+#define POWER_BUDGET 6000
+
+// time between clock sync requests to the leader, in milliseconds
+#define SYNC_INTERVAL 1000
+
+// time from the leader completing a frame to every cube showing it, long
+// enough for SYNC_PRESENT to reach the followers; in microseconds
+#define SYNC_PRESENT_DELAY 30000
+
+// a held frame is shown anyway once it has waited this long, in milliseconds
+#define SYNC_PRESENT_TIMEOUT 100
+
+// longest time between listen() calls: one wait for packets and handling
+// them, in microseconds; a held frame due sooner is waited for exactly
+#define SYNC_PASS_TIME (POLLER_TIMEOUT + 2000)
+
+// cubes that asked for the time this recently are sent SYNC_PRESENT
+#define MAX_FOLLOWERS 4
+#define SYNC_FOLLOWER_TIMEOUT (3 * SYNC_INTERVAL)
+
+// axes for Cube::plane
+#define X_AXIS 0
+#define Y_AXIS 1
+#define Z_AXIS 2
+
 /**   An RGB color. */
 struct Color
 {
@@ -38,18 +74,58 @@ struct Point
 class Cube
 {
   private:
+    struct Follower {
+      IPAddress address;
+      uint16_t port;
+      unsigned long lastSeen;
+
+      Follower() : port(0), lastSeen(0) {}
+    };
+
+    static Cube *instance;
+
     unsigned int size;
     unsigned int maxBrightness;
     bool onlinePressed;
     bool lastOnline;
-    Adafruit_NeoPixel strip;
+    NeoPixel<PIXEL_TYPE> strip;
     UDP udp;
     int lastUpdated;
     char localIP[24];
     char macAddress[20];
     int port;
+    uint8_t frame[PIXEL_COUNT];
+    uint8_t packet[RX_BUF_MAX_SIZE];  // the datagram listen() is handling
+    FrameAssembler assembler;
+    UDP syncUdp;
+    ClockSync clock;
+    IPAddress leader;
+    bool hasLeader;
+    unsigned long lastSyncRequest;
+    int clockOffset;
+    bool framePending;
+    uint16_t pendingSequence;
+    unsigned long pendingSince;
+    bool presentKnown;
+    uint16_t presentSequence;
+    uint32_t presentAt;
+    Follower followers[MAX_FOLLOWERS];
+    SocketPoller localPoller;
+    SocketPoller *poller;
+    int powerBudget;
+    int frameCurrent;
 
     void emptyFlatCircle(int x, int y, int z, int r, Color col);
+    void latchFrame(uint16_t sequence);
+    void presentFrame(void);
+    void serviceSync(void);
+    void addFollower(IPAddress address, uint16_t port);
+    int sendPresent(uint16_t sequence, uint32_t at);
+
+    static int setPortFunction(String port);
+    static int setLeaderFunction(String address);
+    static int setPowerBudgetFunction(String milliamps);
+    static void checkCloudButtonInterrupt(void);
 
   public:
     Cube(unsigned int s, unsigned int mb);
@@ -57,6 +133,7 @@ class Cube
 
     void setVoxel(unsigned int x, unsigned int y, unsigned int z, Color col);
     void setVoxel(Point p, Color col);
+    void drawFrame(const uint8_t *data);
     Color getVoxel(int x, int y, int z);
     Color getVoxel(Point p);
     void line(int x1, int y1, int z1, int x2, int y2, int z2, Color col);
@@ -65,18 +142,24 @@ class Cube
     void sphere(Point p, int r, Color col);
     void shell(int x, int y, int z, int r, Color col);
     void shell(Point p, int r, Color col);
+    void box(int x1, int y1, int z1, int x2, int y2, int z2, Color col);
+    void box(Point p1, Point p2, Color col);
+    void plane(int axis, int offset, Color col);
     void background(Color col);
 
     Color colorMap(float val, float min, float max);
     Color lerpColor(Color a, Color b, int val, int min, int max);
 
     void begin(void);
+    void setPoller(SocketPoller &socketPoller);
     void show(void);
     void listen(void);
     void initCloudButton(void);
     void checkCloudButton(void);
     void updateNetworkInfo(void);
     int setPort(String port);
+    int setLeader(String address);
+    int setPowerBudget(String milliamps);
 };
 
 // common colors
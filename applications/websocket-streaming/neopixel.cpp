@@ -37,29 +37,69 @@
   -------------------------------------------------------------------------*/
 
 #include "neopixel.h"
+#include "pool_alloc.h"
+
+// Pixels encoded per half of the DMA buffer.  The other half is refilled
+// while one is output, so RAM stays at 2 x 8 x 24 compare values.
+#define DMA_CHUNK_PIXELS 8
+#define DMA_HALF_SLOTS   (DMA_CHUNK_PIXELS * 24)
+
+static Adafruit_NeoPixel *dmaStrip = NULL;
+static uint16_t dmaBuffer[2 * DMA_HALF_SLOTS];
+
+#ifndef SPARK_POSIX
+extern "C" void DMA1_Channel7_IRQHandler(void) {
+  if(dmaStrip) dmaStrip->dmaInterrupt();
+}
+#endif
 
 Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, uint8_t t) : \
-  numLEDs(n), numBytes(n*3), type(t), pin(p), pixels(NULL)
+  numLEDs(n), numBytes(n*3), type(t), pin(p), pixels(NULL), stripCount(1),
+  dmaBusy(false), useDMA(false)
 {
-  if((pixels = (uint8_t *)malloc(numBytes))) {
+#ifdef STATIC_FRAME_ARENA
+  pixels = frameArena.take(numBytes);
+#else
+  pixels = (uint8_t *)pool_malloc(numBytes);
+#endif
+  if(pixels) {
     memset(pixels, 0, numBytes);
   }
 }
 
 Adafruit_NeoPixel::~Adafruit_NeoPixel() {
-  if(pixels) free(pixels);
+  if(dmaStrip == this) {
+#ifndef SPARK_POSIX
+    TIM_Cmd(TIM4, DISABLE);
+    DMA_Cmd(DMA1_Channel7, DISABLE);
+#endif
+    dmaStrip = NULL;
+  }
+#ifndef STATIC_FRAME_ARENA
+  if(pixels) pool_free(pixels);
+#endif
   pinMode(pin, INPUT);
+  for(uint8_t s=1; s<stripCount; s++) pinMode(pins[s], INPUT);
 }
 
 void Adafruit_NeoPixel::begin(void) {
   pinMode(pin, OUTPUT);
   digitalWrite(pin, LOW);
+  for(uint8_t s=1; s<stripCount; s++) {
+    pinMode(pins[s], OUTPUT);
+    digitalWrite(pins[s], LOW);
+  }
 }
 
 void Adafruit_NeoPixel::show(void) {
   if(!pixels) return;
 
-  // Data latch = 24 or 50 microsecond pause in the output stream.  Rather than
+  if(useDMA) {
+    showDMA();
+    return;
+  }
+
+  // Data latch = 24, 50 or 500 microsecond pause in the output stream.  Rather than
   // put a delay at the end of the function, the ending time is noted and
   // the function will simply hold off (if needed) on issuing the
   // subsequent round of data until the latch time has elapsed.  This
@@ -84,6 +124,27 @@ void Adafruit_NeoPixel::show(void) {
   // instances on different pins can be quickly issued in succession (each
   // instance doesn't delay the next).
 
+  if(stripCount > 1) showParallel();
+  else switch(type) {
+    case WS2812B: showBitstream<WS2812B>(); break;
+    case WS2811:  showBitstream<WS2811>();  break;
+    case TM1803:  showBitstream<TM1803>();  break;
+    default:      showBitstream<TM1829>();  break;
+  }
+  endTime = micros(); // Save EOD time for latch on next call
+}
+
+#ifdef SPARK_POSIX
+// A native build has no strip, the platform keeps each frame in memory
+template<uint8_t TYPE>
+void Adafruit_NeoPixel::showBitstream(void) {
+  Native_Show_Pixels(pixels, numBytes);
+}
+#else
+// Timed bitstream for one pixel type.  TYPE is a template parameter so
+// each stream is compiled on its own, with no type checks at run time.
+template<uint8_t TYPE>
+void Adafruit_NeoPixel::showBitstream(void) {
   __disable_irq(); // Need 100% focus on instruction timing
 
   volatile uint32_t 
@@ -97,7 +158,7 @@ void Adafruit_NeoPixel::show(void) {
     r,              // Current red byte value
     b;              // Current blue byte value
   
-  if(type == WS2812B) { // same as WS2812, 800 KHz bitstream
+  if(TYPE == WS2812B) { // same as WS2812, 800 KHz bitstream
     while(i) { // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000; // reset the mask
       i = i-3;      // decrement bytes remaining
@@ -157,7 +218,7 @@ void Adafruit_NeoPixel::show(void) {
       } while ( ++j < 24 ); // ... pixel done
     } // end while(i) ... no more pixels
   }
-  else if(type == WS2811) { // WS2811, 400 KHz bitstream
+  else if(TYPE == WS2811) { // WS2811, 400 KHz bitstream
     while(i) { // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000; // reset the mask
       i = i-3;      // decrement bytes remaining
@@ -251,7 +312,7 @@ void Adafruit_NeoPixel::show(void) {
       } while ( ++j < 24 ); // ... pixel done
     } // end while(i) ... no more pixels
   }
-  else if(type == TM1803) { // TM1803 (Radio Shack Tri-Color Strip), 400 KHz bitstream
+  else if(TYPE == TM1803) { // TM1803 (Radio Shack Tri-Color Strip), 400 KHz bitstream
     while(i) { // While bytes left... (3 bytes = 1 pixel)
       mask = 0x800000; // reset the mask
       i = i-3;      // decrement bytes remaining
@@ -393,8 +454,13 @@ void Adafruit_NeoPixel::show(void) {
   }
 
   __enable_irq();
-  endTime = micros(); // Save EOD time for latch on next call
 }
+#endif
+
+template void Adafruit_NeoPixel::showBitstream<WS2812B>(void);
+template void Adafruit_NeoPixel::showBitstream<WS2811>(void);
+template void Adafruit_NeoPixel::showBitstream<TM1803>(void);
+template void Adafruit_NeoPixel::showBitstream<TM1829>(void);
 
 // Set the output pin number
 void Adafruit_NeoPixel::setPin(uint8_t p) {
@@ -404,9 +470,85 @@ void Adafruit_NeoPixel::setPin(uint8_t p) {
   digitalWrite(p, LOW);
 }
 
-// Set pixel color from separate R,G,B components:
+// Split the strip into 'count' equal parts driven in parallel, part s on
+// pin p[s].  All pins must be on the same GPIO port and only the 800 KHz
+// WS2812/WS2812B bitstream is supported; otherwise output stays serial on
+// p[0].  Show time drops by roughly the number of strips.
+void Adafruit_NeoPixel::setPins(const uint8_t *p, uint8_t count) {
+  for(uint8_t s=1; s<stripCount; s++) pinMode(pins[s], INPUT);
+  setPin(p[0]);
+  stripCount = 1;
+
+  if(type != WS2812B || count < 2 || count > MAX_STRIPS) return;
+
+  uint16_t masks[MAX_STRIPS];
+  portMask = 0;
+  for(uint8_t s=0; s<count; s++) {
+    if(PIN_MAP[p[s]].gpio_peripheral != PIN_MAP[p[0]].gpio_peripheral) return;
+    pins[s]  = p[s];
+    masks[s] = PIN_MAP[p[s]].gpio_pin;
+    portMask |= masks[s];
+  }
+  transposeTable(portTable, masks, count);
+
+  stripCount = count;
+  for(uint8_t s=1; s<stripCount; s++) {
+    pinMode(pins[s], OUTPUT);
+    digitalWrite(pins[s], LOW);
+  }
+}
+
+// 800 KHz bitstream on up to 8 pins at once.  Each bit slot raises every
+// pin, drops the pins sending a 0 after T0H and the rest after T1H, so a
+// slot costs three port writes no matter how many strips there are.  The
+// next byte of every strip is transposed while all lines are low, which
+// only stretches the low time of the last bit of each byte.
+// Sled lengths are counted for 72 MHz; check T0H/T1H with a scope after
+// changing this loop.
+#ifdef SPARK_POSIX
+void Adafruit_NeoPixel::showParallel(void) {
+  Native_Show_Pixels(pixels, numBytes);
+}
+#else
+void Adafruit_NeoPixel::showParallel(void) {
+  GPIO_TypeDef *port = PIN_MAP[pins[0]].gpio_peripheral;
+  const uint16_t all = portMask;
+  const uint16_t stripBytes = ((numLEDs + stripCount - 1) / stripCount) * 3;
+  uint8_t  column[MAX_STRIPS];
+  uint16_t words[8], zeros[8];
+
+  __disable_irq(); // Need 100% focus on instruction timing
+
+  for(uint16_t i=0; i<stripBytes; i++) {
+    for(uint8_t s=0; s<MAX_STRIPS; s++) {
+      uint16_t ofs = s * stripBytes + i;
+      column[s] = (s < stripCount && ofs < numBytes) ? pixels[ofs] : 0;
+    }
+    transposeSlots(words, column, portTable);
+    for(uint8_t b=0; b<8; b++) zeros[b] = all & ~words[b];
+
+    for(uint8_t b=0; b<8; b++) {
+      port->BSRR = all;      // HIGH, start of bit
+      // WS2812 spec 350ns HIGH for a 0
+      asm volatile(".rept 20" "\n\t" "nop" "\n\t" ".endr" ::: "memory");
+      port->BRR = zeros[b];  // LOW for strips sending 0
+      // WS2812 spec 700ns HIGH for a 1
+      asm volatile(".rept 22" "\n\t" "nop" "\n\t" ".endr" ::: "memory");
+      port->BRR = all;       // LOW for strips sending 1
+      // WS2812 spec 1.25us bit period
+      asm volatile(".rept 30" "\n\t" "nop" "\n\t" ".endr" ::: "memory");
+    }
+  }
+
+  __enable_irq();
+}
+#endif
+
+// Set pixel color from separate R,G,B components.  NeoPixel<TYPE> does
+// the same with the color order fixed at compile time.
 void Adafruit_NeoPixel::setPixelColor(
  uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  while(dmaBusy); // Don't tear the frame being sent
   if(n < numLEDs) {
     if(brightness) { // See notes in setBrightness()
       r = (r * brightness) >> 8;
@@ -415,83 +557,276 @@ void Adafruit_NeoPixel::setPixelColor(
     }
     uint8_t *p = &pixels[n * 3];
     switch(type) {
-      case WS2812B: // WS2812 & WS2812B is GRB order.
-        *p++ = g;
-        *p++ = r;
-        *p = b;
-        break;
-      case TM1829: // TM1829 is special RBG order
-        if(r == 255) r = 254; // 255 on RED channel causes display to be in a special mode.
-        *p++ = r;
-        *p++ = b;
-        *p = g;
-        break;
-      case WS2811: // WS2811 is RGB order
-      case TM1803: // TM1803 is RGB order
-      default:     // default is RGB order
-        *p++ = r;
-        *p++ = g;
-        *p = b;
-        break;
+      case WS2812B: storePixel<WS2812B>(p, r, g, b); break;
+      case TM1829:  storePixel<TM1829>(p, r, g, b);  break;
+      case WS2811:
+      case TM1803:
+      default:      storePixel<WS2811>(p, r, g, b);  break; // RGB order
     }
   }
 }
 
 // Set pixel color from 'packed' 32-bit RGB color:
 void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
-  if(n < numLEDs) {
-    uint8_t
-      r = (uint8_t)(c >> 16),
-      g = (uint8_t)(c >>  8),
-      b = (uint8_t)c;
+  setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+}
+
+// Convert separate R,G,B into packed 32-bit RGB color.
+// Packed format is always RGB, regardless of LED strand color order.
+uint32_t Adafruit_NeoPixel::Color(uint8_t r, uint8_t g, uint8_t b) {
+  return ((uint32_t)r << 16) | ((uint32_t)g <<  8) | b;
+}
+
+// Set 'count' pixels from a buffer of R,G,B triplets in one pass.  If
+// 'order' is given, triplet i goes to pixel order[i] (lets callers whose
+// pixel numbering differs from the wiring skip a remapping copy).  With
+// RGB-ordered pixels, no remapping and full brightness this is a memcpy.
+void Adafruit_NeoPixel::setPixels(
+ const uint8_t *rgb, uint16_t count, const uint16_t *order) {
+  switch(type) {
+    case WS2812B: writePixels<WS2812B>(rgb, count, order); break;
+    case TM1829:  writePixels<TM1829>(rgb, count, order);  break;
+    default:      writePixels<WS2811>(rgb, count, order);  break;
+  }
+}
+
+// Set 'count' pixels from a buffer of palette indices.  'palette' holds
+// packed 32-bit RGB colors; 'order' remaps as above.  'scale' dims just
+// these pixels, on top of the strip brightness (same range as
+// setBrightness(), 255 = as given).
+void Adafruit_NeoPixel::setPixels(const uint8_t *indices,
+ const uint32_t *palette, uint16_t count, const uint16_t *order,
+ uint8_t scale) {
+  switch(type) {
+    case WS2812B: writePixels<WS2812B>(indices, palette, count, order, scale); break;
+    case TM1829:  writePixels<TM1829>(indices, palette, count, order, scale);  break;
+    default:      writePixels<WS2811>(indices, palette, count, order, scale);  break;
+  }
+}
+
+template<uint8_t TYPE>
+void Adafruit_NeoPixel::writePixels(
+ const uint8_t *rgb, uint16_t count, const uint16_t *order) {
+  while(dmaBusy); // Don't tear the frame being sent
+  if(count > numLEDs) count = numLEDs;
+
+  if(!order && !brightness && NeoPixelType<TYPE>::R == 0 &&
+     NeoPixelType<TYPE>::G == 1 && NeoPixelType<TYPE>::B == 2) {
+    memcpy(pixels, rgb, count * 3);
+    return;
+  }
+
+  for(uint16_t i = 0; i < count; i++, rgb += 3) {
+    uint16_t n = order ? order[i] : i;
+    if(n >= numLEDs) continue;
+    uint8_t r = rgb[0], g = rgb[1], b = rgb[2];
     if(brightness) { // See notes in setBrightness()
       r = (r * brightness) >> 8;
       g = (g * brightness) >> 8;
       b = (b * brightness) >> 8;
     }
-    uint8_t *p = &pixels[n * 3];
-    switch(type) {
-      case WS2812B: // WS2812 & WS2812B is GRB order.
-        *p++ = g;
-        *p++ = r;
-        *p = b;
-        break;
-      case TM1829: // TM1829 is special RBG order
-        if(r == 255) r = 254; // 255 on RED channel causes display to be in a special mode.
-        *p++ = r;
-        *p++ = b;
-        *p = g;
-        break;
-      case WS2811: // WS2811 is RGB order
-      case TM1803: // TM1803 is RGB order
-      default:     // default is RGB order
-        *p++ = r;
-        *p++ = g;
-        *p = b;
-        break;
-    }
+    storePixel<TYPE>(&pixels[n * 3], r, g, b);
   }
 }
 
-// Convert separate R,G,B into packed 32-bit RGB color.
-// Packed format is always RGB, regardless of LED strand color order.
-uint32_t Adafruit_NeoPixel::Color(uint8_t r, uint8_t g, uint8_t b) {
-  return ((uint32_t)r << 16) | ((uint32_t)g <<  8) | b;
+template<uint8_t TYPE>
+void Adafruit_NeoPixel::writePixels(const uint8_t *indices,
+ const uint32_t *palette, uint16_t count, const uint16_t *order,
+ uint8_t scale) {
+  while(dmaBusy); // Don't tear the frame being sent
+  if(count > numLEDs) count = numLEDs;
+
+  // Combined 1-256 multiplier of brightness (0 = max) and scale
+  uint16_t level = ((brightness ? brightness : 256) * (scale + 1)) >> 8;
+
+  for(uint16_t i = 0; i < count; i++) {
+    uint16_t n = order ? order[i] : i;
+    if(n >= numLEDs) continue;
+    uint32_t c = palette[indices[i]];
+    uint8_t  r = c >> 16, g = c >> 8, b = c;
+    if(level < 256) {
+      r = (r * level) >> 8;
+      g = (g * level) >> 8;
+      b = (b * level) >> 8;
+    }
+    storePixel<TYPE>(&pixels[n * 3], r, g, b);
+  }
 }
 
+#define NEOPIXEL_WRITE_PIXELS(TYPE) \
+  template void Adafruit_NeoPixel::writePixels<TYPE>( \
+    const uint8_t *, uint16_t, const uint16_t *); \
+  template void Adafruit_NeoPixel::writePixels<TYPE>( \
+    const uint8_t *, const uint32_t *, uint16_t, const uint16_t *, uint8_t);
+NEOPIXEL_WRITE_PIXELS(WS2812B)
+NEOPIXEL_WRITE_PIXELS(WS2811)
+NEOPIXEL_WRITE_PIXELS(TM1803)
+NEOPIXEL_WRITE_PIXELS(TM1829)
+#undef NEOPIXEL_WRITE_PIXELS
+
 // Query color from previously-set pixel (returns packed 32-bit RGB value)
 uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
 
   if(n < numLEDs) {
-    uint16_t ofs = n * 3;
-    return (uint32_t)(pixels[ofs + 2]) |
-      ((uint32_t)(pixels[ofs    ]) <<  8) |
-      ((uint32_t)(pixels[ofs + 1]) << 16);
+    const uint8_t *p = &pixels[n * 3];
+    switch(type) {
+      case WS2812B: return loadPixel<WS2812B>(p);
+      case TM1829:  return loadPixel<TM1829>(p);
+      default:      return loadPixel<WS2811>(p);
+    }
   }
 
   return 0; // Pixel # is out of bounds
 }
 
+// Drive the strip from TIM4 and DMA1 channel 7 instead of a timed loop.
+// The bitstream is encoded into timer compare values a few pixels at a
+// time from the DMA interrupt, so show() returns at once and interrupts
+// (CC3000, SysTick) keep running while the frame goes out.  Only the
+// 800 KHz WS2812/WS2812B bitstream on D0 or D1 (TIM4) is supported, and
+// Wire can't use DMA mode at the same time.  Returns false, leaving the
+// timed loop in use, if the strip can't be driven this way.
+#ifdef SPARK_POSIX
+bool Adafruit_NeoPixel::beginDMA(void) {
+  return false;
+}
+#else
+bool Adafruit_NeoPixel::beginDMA(void) {
+  if(type != WS2812B || stripCount > 1 ||
+     PIN_MAP[pin].timer_peripheral != TIM4 ||
+     (dmaStrip != NULL && dmaStrip != this)) return false;
+
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+  RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+  pinMode(pin, AF_OUTPUT_PUSHPULL);
+
+  TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+  TIM_TimeBaseStructure.TIM_Prescaler = 0; // 72 MHz, see waveform.h
+  TIM_TimeBaseStructure.TIM_Period = WS2812_PERIOD - 1;
+  TIM_TimeBaseStructure.TIM_ClockDivision = 0;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseInit(TIM4, &TIM_TimeBaseStructure);
+
+  TIM_OCInitTypeDef TIM_OCInitStructure;
+  TIM_OCStructInit(&TIM_OCInitStructure);
+  TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+  TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+  TIM_OCInitStructure.TIM_OCPolarity = TIM_OCPolarity_High;
+  TIM_OCInitStructure.TIM_Pulse = 0; // LOW while idle
+  if(PIN_MAP[pin].timer_ch == TIM_Channel_1) {
+    TIM_OC1Init(TIM4, &TIM_OCInitStructure);
+    TIM_OC1PreloadConfig(TIM4, TIM_OCPreload_Enable);
+    dmaCCR = &TIM4->CCR1;
+  } else {
+    TIM_OC2Init(TIM4, &TIM_OCInitStructure);
+    TIM_OC2PreloadConfig(TIM4, TIM_OCPreload_Enable);
+    dmaCCR = &TIM4->CCR2;
+  }
+  TIM_ARRPreloadConfig(TIM4, ENABLE);
+
+  // Each update event loads the compare value for the next bit
+  TIM_DMACmd(TIM4, TIM_DMA_Update, ENABLE);
+
+  NVIC_InitTypeDef NVIC_InitStructure;
+  NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel7_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 12; // A refill has a whole half buffer (240us) to run
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  dmaStrip = this;
+  useDMA   = true;
+  return true;
+}
+#endif
+
+// True when show() can be called without waiting: the previous frame has
+// been sent and the latch time has passed.
+bool Adafruit_NeoPixel::canShow(void) const {
+  if(dmaBusy) return false;
+  // The DMA transfer ends with its own latch; the timed loop waits 24-500us
+  return useDMA || (micros() - endTime) >= (type == TM1829 ? 500L : 50L);
+}
+
+// Start sending the frame and return.  Waits only for a previous frame
+// still being sent.
+#ifdef SPARK_POSIX
+void Adafruit_NeoPixel::showDMA(void) {
+  Native_Show_Pixels(pixels, numBytes);
+}
+#else
+void Adafruit_NeoPixel::showDMA(void) {
+  while(dmaBusy);
+
+  dmaOffset      = 0;
+  dmaHalfData[0] = fillDMA(0);
+  dmaHalfData[1] = fillDMA(1);
+  dmaBusy        = true;
+
+  DMA_InitTypeDef DMA_InitStructure;
+  DMA_DeInit(DMA1_Channel7);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)dmaCCR;
+  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)dmaBuffer;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+  DMA_InitStructure.DMA_BufferSize = 2 * DMA_HALF_SLOTS;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+  DMA_Init(DMA1_Channel7, &DMA_InitStructure);
+  DMA_ITConfig(DMA1_Channel7, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  TIM_SetCounter(TIM4, 0);
+  DMA_Cmd(DMA1_Channel7, ENABLE);
+  TIM_Cmd(TIM4, ENABLE);
+}
+#endif
+
+// Encode the next chunk of pixels into one half of the DMA buffer.
+// Returns false once there is no pixel data left, leaving the half LOW.
+bool Adafruit_NeoPixel::fillDMA(uint8_t half) {
+  uint16_t n = encodeWaveform(dmaBuffer + half * DMA_HALF_SLOTS, DMA_HALF_SLOTS,
+                              pixels + dmaOffset, numBytes - dmaOffset);
+  dmaOffset += n;
+  return n > 0;
+}
+
+// Called from DMA1_Channel7_IRQHandler when either half of the buffer has
+// been sent.  Refills that half, or stops once a half holding no data has
+// gone out, which is 240us LOW and so covers the latch.
+#ifdef SPARK_POSIX
+void Adafruit_NeoPixel::dmaInterrupt(void) {
+}
+#else
+void Adafruit_NeoPixel::dmaInterrupt(void) {
+  uint8_t half;
+
+  if(DMA_GetITStatus(DMA1_IT_HT7) != RESET) {
+    half = 0;
+  } else if(DMA_GetITStatus(DMA1_IT_TC7) != RESET) {
+    half = 1;
+  } else {
+    return;
+  }
+  DMA_ClearITPendingBit(half ? DMA1_IT_TC7 : DMA1_IT_HT7);
+
+  if(!dmaHalfData[half]) {
+    TIM_Cmd(TIM4, DISABLE);
+    DMA_Cmd(DMA1_Channel7, DISABLE);
+    *dmaCCR = 0;
+    endTime = micros();
+    dmaBusy = false;
+    return;
+  }
+
+  dmaHalfData[half] = fillDMA(half);
+}
+#endif
+
 uint8_t *Adafruit_NeoPixel::getPixels(void) const {
   return pixels;
 }
@@ -520,6 +855,7 @@ void Adafruit_NeoPixel::setBrightness(uint8_t b) {
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
+  while(dmaBusy); // Don't tear the frame being sent
   if(newBrightness != brightness) { // Compare against prior value
     // Brightness has changed -- re-scale existing data in RAM
     uint8_t  c,
@@ -40,6 +40,9 @@
 #define SPARK_NEOPIXEL_H
 
 #include "application.h"
+#include "bit-transpose.h"
+#include "waveform.h"
+#include "frame-arena.h"
 
 // 'type' flags for LED pixels (third parameter to constructor):
 #define WS2812   0x02 // 800 KHz datastream (NeoPixel)
@@ -47,6 +50,14 @@
 #define WS2811   0x00 // 400 KHz datastream (NeoPixel)
 #define TM1803   0x03 // 400 KHz datastream (Radio Shack Tri-Color Strip)
 #define TM1829   0x04 // 800 KHz datastream ()
+
+// Compile-time description of each pixel type: byte offsets of red, green
+// and blue within a pixel, and the reset latch in microseconds.
+template<uint8_t TYPE> struct NeoPixelType;
+template<> struct NeoPixelType<WS2812B> { enum { R = 1, G = 0, B = 2, LATCH = 50 }; };  // GRB
+template<> struct NeoPixelType<WS2811>  { enum { R = 0, G = 1, B = 2, LATCH = 50 }; };  // RGB
+template<> struct NeoPixelType<TM1803>  { enum { R = 0, G = 1, B = 2, LATCH = 24 }; };  // RGB
+template<> struct NeoPixelType<TM1829>  { enum { R = 0, G = 2, B = 1, LATCH = 500 }; }; // RBG
   
 class Adafruit_NeoPixel {
 
@@ -60,9 +71,18 @@ class Adafruit_NeoPixel {
     begin(void),
     show(void) __attribute__((optimize("Ofast"))),
     setPin(uint8_t p),
+    setPins(const uint8_t *p, uint8_t count),
     setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
     setPixelColor(uint16_t n, uint32_t c),
+    setPixels(const uint8_t *rgb, uint16_t count, const uint16_t *order=NULL),
+    setPixels(const uint8_t *indices, const uint32_t *palette,
+      uint16_t count, const uint16_t *order=NULL, uint8_t scale=255),
     setBrightness(uint8_t);
+  bool
+    beginDMA(void),
+    canShow(void) const;
+  void
+    dmaInterrupt(void);
   uint8_t
    *getPixels() const;
   uint16_t
@@ -72,7 +92,7 @@ class Adafruit_NeoPixel {
   uint32_t
     getPixelColor(uint16_t n) const;
 
- private:
+ protected:
 
   const uint16_t
     numLEDs,       // Number of RGB LEDs in strip
@@ -85,6 +105,102 @@ class Adafruit_NeoPixel {
    *pixels;        // Holds LED color values (3 bytes each)
   uint32_t
     endTime;       // Latch timing reference
+  uint8_t
+    pins[MAX_STRIPS], // Parallel output pins, all on one GPIO port
+    stripCount;    // Number of parallel strips, 1 = serial output on 'pin'
+  uint16_t
+    portMask,      // Port bits of all parallel pins
+    portTable[32]; // Lookup table for transposeSlots()
+
+  volatile bool
+    dmaBusy;       // Timer+DMA transfer in progress
+  bool
+    useDMA,        // show() starts a timer+DMA transfer
+    dmaHalfData[2]; // Each half of the DMA buffer holds pixel data
+  uint16_t
+    dmaOffset;     // Next byte of 'pixels' to encode
+  volatile uint16_t
+   *dmaCCR;        // Timer compare register of 'pin'
+
+  void
+    showParallel(void) __attribute__((optimize("Ofast"))),
+    showDMA(void);
+  bool
+    fillDMA(uint8_t half);
+  template<uint8_t TYPE> void
+    showBitstream(void) __attribute__((optimize("Ofast")));
+  template<uint8_t TYPE> void
+    writePixels(const uint8_t *rgb, uint16_t count, const uint16_t *order);
+  template<uint8_t TYPE> void
+    writePixels(const uint8_t *indices, const uint32_t *palette,
+      uint16_t count, const uint16_t *order, uint8_t scale);
+
+  template<uint8_t TYPE> static inline void
+    storePixel(uint8_t *p, uint8_t r, uint8_t g, uint8_t b) {
+      if(TYPE == TM1829 && r == 255) r = 254; // 255 on RED channel causes display to be in a special mode.
+      p[NeoPixelType<TYPE>::R] = r;
+      p[NeoPixelType<TYPE>::G] = g;
+      p[NeoPixelType<TYPE>::B] = b;
+    }
+  template<uint8_t TYPE> static inline uint32_t
+    loadPixel(const uint8_t *p) {
+      return ((uint32_t)p[NeoPixelType<TYPE>::R] << 16) |
+             ((uint32_t)p[NeoPixelType<TYPE>::G] <<  8) |
+              (uint32_t)p[NeoPixelType<TYPE>::B];
+    }
+};
+
+// Strip with its pixel type fixed at compile time.  Color order, timing
+// and latch are resolved by the compiler, so setting a pixel is three byte
+// stores and show() has no type dispatch.  Adafruit_NeoPixel remains for
+// code that picks the type at run time.
+template<uint8_t TYPE>
+class NeoPixel : public Adafruit_NeoPixel {
+
+ public:
+
+  NeoPixel(uint16_t n, uint8_t p=2) : Adafruit_NeoPixel(n, p, TYPE) { }
+
+  void show(void) {
+    if(!pixels) return;
+    if(useDMA) {
+      showDMA();
+      return;
+    }
+    while((micros() - endTime) < NeoPixelType<TYPE>::LATCH);
+    if(stripCount > 1) showParallel();
+    else showBitstream<TYPE>();
+    endTime = micros(); // Save EOD time for latch on next call
+  }
+
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    while(dmaBusy); // Don't tear the frame being sent
+    if(n < numLEDs) {
+      if(brightness) { // See notes in Adafruit_NeoPixel::setBrightness()
+        r = (r * brightness) >> 8;
+        g = (g * brightness) >> 8;
+        b = (b * brightness) >> 8;
+      }
+      storePixel<TYPE>(&pixels[n * 3], r, g, b);
+    }
+  }
+
+  void setPixelColor(uint16_t n, uint32_t c) {
+    setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c);
+  }
+
+  void setPixels(const uint8_t *rgb, uint16_t count, const uint16_t *order=NULL) {
+    writePixels<TYPE>(rgb, count, order);
+  }
+
+  void setPixels(const uint8_t *indices, const uint32_t *palette,
+      uint16_t count, const uint16_t *order=NULL, uint8_t scale=255) {
+    writePixels<TYPE>(indices, palette, count, order, scale);
+  }
+
+  uint32_t getPixelColor(uint16_t n) const {
+    return (n < numLEDs) ? loadPixel<TYPE>(&pixels[n * 3]) : 0;
+  }
 };
 
 #endif // ADAFRUIT_NEOPIXEL_H
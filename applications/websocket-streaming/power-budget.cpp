@@ -0,0 +1,93 @@
+#include "power-budget.h"
+
+/** Estimate the current drawn while a frame of palette colors is shown.
+
+  @param indices Palette index of each pixel.
+  @param palette Packed 32-bit RGB colors.
+  @param count Number of pixels.
+
+  @return Estimated current in mA.
+  */
+uint32_t estimateCurrent(const uint8_t *indices, const uint32_t *palette, uint16_t count)
+{
+  uint32_t sum = 0;
+
+  for(uint16_t i = 0; i < count; i++) {
+    uint32_t c = palette[indices[i]];
+    sum += ((c >> 16) & 0xFF) + ((c >> 8) & 0xFF) + (c & 0xFF);
+  }
+
+  return (sum * LED_CHANNEL_MA + 127) / 255 + (uint32_t)count * LED_IDLE_MA;
+}
+
+/** Estimate the current drawn while a strip's pixel buffer is shown.
+
+  @param pixels Three channel bytes per pixel, in any order.
+  @param count Number of pixels.
+
+  @return Estimated current in mA.
+  */
+uint32_t estimatePixelCurrent(const uint8_t *pixels, uint16_t count)
+{
+  uint32_t sum = 0;
+
+  for(uint32_t i = 0; i < (uint32_t)count * 3; i++)
+    sum += pixels[i];
+
+  return (sum * LED_CHANNEL_MA + 127) / 255 + (uint32_t)count * LED_IDLE_MA;
+}
+
+/** Brightness scale that keeps a frame within a current budget.
+  Only the channel current scales, the idle current of the pixels does not.
+
+  @param milliamps Estimated current of the frame, from estimateCurrent().
+  @param budget Current the supply can deliver, in mA.
+  @param count Number of pixels in the frame.
+
+  @return Scale in the style of Adafruit_NeoPixel::setBrightness(), 255 leaves
+  the frame as it is.
+  */
+uint8_t budgetScale(uint32_t milliamps, uint32_t budget, uint16_t count)
+{
+  if(milliamps <= budget)
+    return 255;
+
+  uint32_t idle = (uint32_t)count * LED_IDLE_MA;
+  if(budget <= idle)
+    return 0;
+
+  // colors are multiplied by (scale + 1) / 256, round that down
+  uint32_t level = (budget - idle) * 256 / (milliamps - idle);
+  return level ? level - 1 : 0;
+}
+
+/** Dim a pixel buffer evenly.
+
+  @param pixels Three channel bytes per pixel.
+  @param count Number of pixels.
+  @param scale Scale from budgetScale(), 255 leaves the pixels as they are.
+  */
+void scalePixels(uint8_t *pixels, uint16_t count, uint8_t scale)
+{
+  if(scale == 255)
+    return;
+
+  for(uint32_t i = 0; i < (uint32_t)count * 3; i++)
+    pixels[i] = (pixels[i] * (scale + 1)) >> 8;
+}
+
+/** Keep a pixel buffer within a current budget, dimming it if needed.
+
+  @param pixels Three channel bytes per pixel.
+  @param count Number of pixels.
+  @param budget Current the supply can deliver, in mA.
+
+  @return Estimated current of the pixels as given, before any dimming.
+  */
+uint32_t limitPixels(uint8_t *pixels, uint16_t count, uint32_t budget)
+{
+  uint32_t current = estimatePixelCurrent(pixels, count);
+
+  scalePixels(pixels, count, budgetScale(current, budget, count));
+  return current;
+}
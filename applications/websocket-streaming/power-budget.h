@@ -0,0 +1,21 @@
+#ifndef _POWER_BUDGET_H
+#define _POWER_BUDGET_H
+
+#include <stdint.h>
+
+/*  Supply current of a frame of WS2812 pixels.
+
+    Each color channel draws up to LED_CHANNEL_MA at full scale, roughly in
+    proportion to its value, and every pixel draws LED_IDLE_MA when dark.
+*/
+
+#define LED_CHANNEL_MA 20 // mA per channel at 255
+#define LED_IDLE_MA    1  // mA per pixel with all channels at 0
+
+uint32_t estimateCurrent(const uint8_t *indices, const uint32_t *palette, uint16_t count);
+uint32_t estimatePixelCurrent(const uint8_t *pixels, uint16_t count);
+uint8_t budgetScale(uint32_t milliamps, uint32_t budget, uint16_t count);
+void scalePixels(uint8_t *pixels, uint16_t count, uint8_t scale);
+uint32_t limitPixels(uint8_t *pixels, uint16_t count, uint32_t budget);
+
+#endif
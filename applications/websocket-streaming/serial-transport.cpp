@@ -0,0 +1,215 @@
+#include <string.h>
+#include "serial-transport.h"
+#include "spark_wiring_print.h"
+
+// CRC-16/CCITT of every 4 bit value, for a nibble at a time
+static const uint16_t crcNibbles[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/** CRC-16/CCITT of a buffer.
+  @param data Bytes to check.
+  @param length Number of bytes.
+  @param crc CRC of the bytes before these, to continue from.
+
+  @return The CRC.
+  */
+uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc)
+{
+  for(size_t i = 0; i < length; i++) {
+    crc = (crc << 4) ^ crcNibbles[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ crcNibbles[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+/** COBS encode a buffer.
+  @param data Bytes to encode.
+  @param length Number of bytes.
+  @param encoded Buffer of at least COBS_ENCODED_SIZE(length) bytes.
+
+  @return Length of the encoding, which holds no zero bytes.
+  */
+size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *encoded)
+{
+  size_t codeAt = 0;
+  size_t out = 1;
+  uint8_t code = 1;
+
+  for(size_t i = 0; i < length; i++) {
+    if(data[i] != 0) {
+      encoded[out++] = data[i];
+      code++;
+    }
+    if(data[i] == 0 || code == 0xFF) {
+      encoded[codeAt] = code;
+      code = 1;
+      codeAt = out++;
+    }
+  }
+  encoded[codeAt] = code;
+  return out;
+}
+
+/** Construct a serial transport.
+  @param stream Stream the frames arrive on and the acknowledgements leave by.
+  @param callBack Function given the payload of each good frame.
+
+  @return A new SerialTransport object.
+  */
+SerialTransport::SerialTransport(Stream &stream, FrameCallBack callBack) : \
+    stream(&stream),
+    callBack(callBack),
+    length(0),
+    code(0),
+    left(0),
+    overflow(false),
+    framesReceived(0),
+    framesInvalid(0),
+    framesTooLong(0)
+{
+#ifdef STATIC_FRAME_ARENA
+  this->frame = frameArena.take(SERIAL_FRAME_SIZE + SERIAL_CRC_SIZE);
+#else
+  this->frame = this->frameBuffer;
+#endif
+}
+
+/** Append decoded bytes to the frame, or note that it is too long. */
+void SerialTransport::store(const uint8_t *data, size_t count)
+{
+  if(this->length + count > SERIAL_FRAME_SIZE + SERIAL_CRC_SIZE) {
+    this->overflow = true;
+    return;
+  }
+  memcpy(this->frame + this->length, data, count);
+  this->length += count;
+}
+
+/** Check the frame just ended and get ready for the next.
+
+  @return The payload length, or -1 if the frame is damaged or empty.
+  */
+int SerialTransport::endFrame(void)
+{
+  int payload = -1;
+
+  if(this->overflow) {
+    this->framesTooLong++;
+  } else if(this->left != 0 || this->length <= SERIAL_CRC_SIZE) {
+    // zeros between frames are only padding
+    if(this->length > 0 || this->code != 0)
+      this->framesInvalid++;
+  } else {
+    unsigned int end = this->length - SERIAL_CRC_SIZE;
+    uint16_t crc = (this->frame[end] << 8) | this->frame[end + 1];
+    if(crc16(this->frame, end) == crc)
+      payload = end;
+    else
+      this->framesInvalid++;
+  }
+
+  this->length = 0;
+  this->code = 0;
+  this->left = 0;
+  this->overflow = false;
+  return payload;
+}
+
+/** Decode received bytes into the frame buffer, up to the end of a frame.
+  @param data Bytes received.
+  @param count Number of bytes.
+  @param payload Set to the payload length when a good frame ends, else -1.
+
+  @return Number of bytes used.
+  */
+size_t SerialTransport::decode(const uint8_t *data, size_t count, int &payload)
+{
+  static const uint8_t zero = 0;
+  size_t i = 0;
+
+  payload = -1;
+  while(i < count) {
+    if(data[i] == 0) {
+      payload = this->endFrame();
+      return i + 1;
+    }
+
+    if(this->left == 0) {
+      // a code byte; every block but a full one ends in a zero, which the
+      // last block of the frame leaves out
+      if(this->code != 0 && this->code != 0xFF)
+        this->store(&zero, 1);
+      this->code = data[i];
+      this->left = data[i] - 1;
+      i++;
+      continue;
+    }
+
+    // copy the rest of the block, stopping early at a zero
+    size_t run = count - i;
+    if(run > this->left)
+      run = this->left;
+    const uint8_t *end = (const uint8_t *)memchr(data + i, 0, run);
+    if(end)
+      run = end - (data + i);
+
+    this->store(data + i, run);
+    this->left -= run;
+    i += run;
+  }
+
+  return i;
+}
+
+/** Encode and send a frame.
+  @param data Payload.
+  @param count Payload length, up to SERIAL_FRAME_SIZE bytes.
+  */
+void SerialTransport::send(const uint8_t *data, size_t count)
+{
+  uint8_t *buffer = frameArena.scratch(count + SERIAL_CRC_SIZE +
+      COBS_ENCODED_SIZE(count + SERIAL_CRC_SIZE) + 1);
+  if(!buffer)
+    return;
+
+  uint16_t crc = crc16(data, count);
+  uint8_t *encoded = buffer + count + SERIAL_CRC_SIZE;
+  memcpy(buffer, data, count);
+  buffer[count] = crc >> 8;
+  buffer[count + 1] = crc & 0xFF;
+
+  size_t length = cobsEncode(buffer, count + SERIAL_CRC_SIZE, encoded);
+  encoded[length++] = 0;
+  this->stream->write(encoded, length);
+}
+
+/** Acknowledge a frame with its payload length. */
+void SerialTransport::sendAck(int payload)
+{
+  char ack[12];
+  BufferPrint text(ack, sizeof(ack));
+  text.print(payload);
+  this->send((const uint8_t *)ack, text.getLength());
+}
+
+/** Decode what has arrived, handing over at most one frame. */
+void SerialTransport::poll(void)
+{
+  const uint8_t *data;
+  size_t available;
+
+  while((available = this->stream->peekBuffer(data)) > 0) {
+    int payload;
+    size_t used = this->decode(data, available, payload);
+    this->stream->consume(used);
+
+    if(payload >= 0) {
+      this->framesReceived++;
+      (*this->callBack)(this->frame, payload);
+      this->sendAck(payload);
+      return;
+    }
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef _SERIAL_TRANSPORT_H
+#define _SERIAL_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spark_wiring_stream.h"
+#include "frame-arena.h"
+
+/*  Binary frames over a serial stream, such as the USB CDC port.
+
+    A frame is its payload followed by a CRC-16/CCITT of the payload
+    (polynomial 0x1021, initial value 0xFFFF, high byte first), COBS encoded
+    and ended by a zero byte. COBS leaves no zero inside a frame, so after a
+    damaged frame, or text written to the same port, the receiver picks up
+    again at the next zero.
+
+    Every good frame is acknowledged with a frame holding its payload length
+    in decimal, as the WebSocket server does.
+*/
+
+#define SERIAL_FRAME_SIZE 512 // largest payload
+#define SERIAL_CRC_SIZE 2
+
+// encoded size of a frame of n bytes, CRC included, without the closing zero
+#define COBS_ENCODED_SIZE(n) ((n) + (n) / 254 + 1)
+
+typedef void (*FrameCallBack)(uint8_t*, int);
+
+uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *encoded);
+
+/**   Receives frames from a stream and hands their payloads to a callback. */
+class SerialTransport
+{
+  private:
+    Stream *stream;
+    FrameCallBack callBack;
+    uint8_t *frame;           // decoded payload and CRC
+    unsigned int length;      // bytes decoded so far
+    uint8_t code;             // code byte of the COBS block being decoded
+    uint8_t left;             // bytes of the block still to come
+    bool overflow;
+#ifndef STATIC_FRAME_ARENA
+    uint8_t frameBuffer[SERIAL_FRAME_SIZE + SERIAL_CRC_SIZE];
+#endif
+
+    void store(const uint8_t *data, size_t count);
+    int endFrame(void);
+    size_t decode(const uint8_t *data, size_t count, int &payload);
+    void sendAck(int payload);
+
+  public:
+    // statistics
+    int framesReceived;
+    int framesInvalid;        // bad CRC or COBS
+    int framesTooLong;
+
+    SerialTransport(Stream &stream, FrameCallBack callBack);
+
+    void poll(void);
+    void send(const uint8_t *data, size_t count);
+};
+
+#endif
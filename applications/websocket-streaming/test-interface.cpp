@@ -1,54 +1,85 @@
 #include "application.h"
 #include "test-interface.h"
-
+#include "pool_alloc.h"
+#include "stack_monitor.h"
+#include "frame-arena.h"
+
+#ifdef SPARK_POSIX
+// No debugger, messages go to stdout and no command ever arrives
+static uint32_t debugRegister;
+volatile uint32_t* DCRDR = &debugRegister;
+#else
 volatile uint32_t* DCRDR = (uint32_t*)DCRDR_ADDR;
+#endif
 
-void asciimsg(const char* msg);
+void asciimsg(const char* msg, uint16_t len);
 
-int countDigits(unsigned long num)
+// Sends each write as one debugger message
+class DebugPrint : public Print
 {
-    int n = 0;
-    while(num) {
-        num /= 10;
-        n++;
+public:
+    size_t write(uint8_t c)
+    {
+        return write(&c, 1);
     }
-    return n;
-}
 
-void reply(const char* msg)
-{
-    int len = 1 + // REPLY marker
-        strlen(msg) +
-        3; // \r\n\0
-
-    char* fullmsg = (char*)calloc(1, len);
-    sprintf(fullmsg, "%c%s\r\n", REPLY, msg);
+    size_t write(const uint8_t* buffer, size_t size)
+    {
+        asciimsg((const char*)buffer, size);
+        return size;
+    }
+};
 
-    asciimsg(fullmsg);
+static DebugPrint debugOut;
 
-    free(fullmsg);
+void reply(const char* msg)
+{
+    debugOut.printf("%c%s\r\n", REPLY, msg);
 }
 
 void info(const char* msg)
 {
-    unsigned long time = micros();
-
-    int len = 1 + // INFO marker
-        countDigits(time) +
-        1 + // space
-        strlen(msg) +
-        3; // \r\n\0
-
-    char* fullmsg = (char*)calloc(1, len);
-    sprintf(fullmsg, "%c%lu %s\r\n", INFO, time, msg);
-
-    asciimsg(fullmsg);
+    debugOut.printf("%c%lu %s\r\n", INFO, micros(), msg);
+}
 
-    free(fullmsg);
+/**
+ * Send the stack high-water mark and the least headroom seen so far, with
+ * the heap and frame arena figures, as a reply or as info.
+ */
+void memoryReport(bool asReply)
+{
+    stack_stats_t stack;
+    heap_stats_t heap;
+    char msg[128];
+    BufferPrint text(msg, sizeof(msg));
+
+    stack_stats(&stack);
+    heap_stats(&heap);
+
+    text.printf("stack=%lu/%lu headroom=%lu heap=%lu/%lu free=%lu failed=%lu arena=%u/%u heapframes=%lu",
+                (unsigned long)stack.high_water, (unsigned long)stack.size,
+                (unsigned long)stack.headroom,
+                (unsigned long)heap.heap_size, (unsigned long)heap.heap_high_water,
+                (unsigned long)heap.free_total, (unsigned long)heap.failed_allocs,
+                (unsigned int)frameArena.used(), (unsigned int)frameArena.size(),
+                (unsigned long)frameArena.heapFrames);
+
+    if (asReply) {
+        reply(msg);
+    } else {
+        info(msg);
+    }
 }
 
 void testTick()
 {
+    static unsigned long lastMemoryReport;
+
+    if (millis() - lastMemoryReport >= MEMORY_REPORT_INTERVAL) {
+        lastMemoryReport = millis();
+        memoryReport(false);
+    }
+
     if (*DCRDR & 0xFF000000) {
         uint8_t command = *DCRDR >> 24;
 
@@ -63,14 +94,17 @@ void testTick()
             {
                 IPAddress ip = WiFi.localIP();
 
-                char* ipMsg = (char*)calloc(1, 24);
-                sprintf(ipMsg, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-                reply(ipMsg);
-                free(ipMsg);
+                debugOut.printf("%c%d.%d.%d.%d\r\n", REPLY, ip[0], ip[1], ip[2], ip[3]);
 
                 break;
             }
 
+            case CMD_MEMORY:
+            {
+                memoryReport(true);
+                break;
+            }
+
             case CMD_DFU:
             {
                 reply("ok");
@@ -81,7 +115,7 @@ void testTick()
             case 'f':
                 reply("ok");
                 while(true) {
-                    memcpy((void*)random(0xFFFFFFFF), (void*)random(0xFFFFFFFF), 256);
+                    memcpy((void*)(uintptr_t)random(0xFFFFFFFF), (void*)(uintptr_t)random(0xFFFFFFFF), 256);
                 }
                 break;
         }
@@ -90,6 +124,18 @@ void testTick()
     }
 }
 
+#ifdef SPARK_POSIX
+void charmsg(char c)
+{
+    putchar(c);
+}
+
+void asciimsg(const char* msg, uint16_t len)
+{
+    fwrite(msg, 1, len, stdout);
+    fflush(stdout);
+}
+#else
 void charmsg(char c)
 {
     uint32_t request[4] = { TARGET_REQ_DEBUGCHAR, 0, (uint32_t)(c << 8), 0 };
@@ -104,10 +150,8 @@ void charmsg(char c)
     }
 }
 
-void asciimsg(const char* msg)
+void asciimsg(const char* msg, uint16_t len)
 {
-    uint16_t len = strlen(msg);
-
     uint32_t request[4] = {
         TARGET_REQ_DEBUGMSG,
         ASCIIMSG,
@@ -133,3 +177,4 @@ void asciimsg(const char* msg)
         }
     }
 }
+#endif
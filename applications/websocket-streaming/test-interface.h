@@ -17,10 +17,15 @@
 #define CMD_IDENTIFY    '?'
 #define CMD_GET_IP      'a'
 #define CMD_DFU         'b'
+#define CMD_MEMORY      'm'
+
+// how often the stack and heap figures are sent as info, in ms
+#define MEMORY_REPORT_INTERVAL 10000
 
 void reply(const char*);
 void info(const char*);
 void writeToDebug(const char* msg);
+void memoryReport(bool asReply);
 void testTick(void);
 
 #endif
@@ -0,0 +1,30 @@
+#include "waveform.h"
+
+/** Encode bytes into timer compare values, most significant bit first.
+
+  @param out Buffer of slots compare values.
+  @param slots Number of values to write, a multiple of 8.
+  @param data Bytes still to be sent.
+  @param length Number of bytes in data.
+
+  @return Number of bytes encoded. Slots past the end of the data are 0,
+  holding the line low for the latch.
+  */
+uint16_t encodeWaveform(uint16_t *out, uint16_t slots, const uint8_t *data, uint16_t length)
+{
+  uint16_t bytes = slots / 8;
+  if(bytes > length)
+    bytes = length;
+
+  for(uint16_t i = 0; i < bytes; i++) {
+    uint8_t c = data[i];
+
+    for(uint8_t mask = 0x80; mask; mask >>= 1)
+      *out++ = (c & mask) ? WS2812_T1H : WS2812_T0H;
+  }
+
+  for(uint16_t i = bytes * 8; i < slots; i++)
+    *out++ = 0;
+
+  return bytes;
+}
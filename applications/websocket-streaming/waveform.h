@@ -0,0 +1,18 @@
+#ifndef _WAVEFORM_H
+#define _WAVEFORM_H
+
+#include <stdint.h>
+
+/*  WS2812 bitstream as PWM compare values.
+
+    The timer runs at 72 MHz with a period of one bit (800 KHz). Each bit
+    becomes one compare value, the time the line stays high.
+*/
+
+#define WS2812_PERIOD 90 // timer ticks per bit, 1.25us
+#define WS2812_T0H    29 // ticks high for a 0, ~400ns
+#define WS2812_T1H    58 // ticks high for a 1, ~800ns
+
+uint16_t encodeWaveform(uint16_t *out, uint16_t slots, const uint8_t *data, uint16_t length);
+
+#endif
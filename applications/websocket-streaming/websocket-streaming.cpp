@@ -4,25 +4,33 @@
 #include "SparkWebSocketServer.h"
 
 #include "l3d-cube.h"
+#include "draw-commands.h"
 #include "test-interface.h"
+#include "serial-transport.h"
 
 //SYSTEM_MODE(MANUAL);
 
 TCPServer server = TCPServer(2525);
 SparkWebSocketServer mine(server);
-void handle(String &cmd, String &result);
+SocketPoller poller;
+void handle(uint8_t *data, int length);
 
 Cube cube = Cube();
 
+// the same frames and commands over USB, when a host is attached
+SerialTransport usbLink(Serial, &handle);
+
 void setup()
 {
     Serial.begin(115200);
 
     server.begin();
+    mine.setPoller(poller);
 
-    CallBack cb = &handle;
-    mine.setCallBack(cb);
+    BinaryCallBack cb = &handle;
+    mine.setBinaryCallBack(cb);
 
+    cube.setPoller(poller);
     cube.begin();
     cube.background(black);
 
@@ -32,47 +40,46 @@ void setup()
     sprintf(msg, "comm=%x", DCRDR_ADDR);
     reply(msg);
 
+#ifndef SPARK_POSIX
     __asm__("BKPT");
+#endif
 }
 
-void displayFrame(String* frame, int offset)
+void displayFrame(uint8_t* frame, int offset)
 {
-    for(unsigned int x = 0; x < 8; x++) {
-        for(unsigned int y = 0; y < 8; y++) {
-            for(unsigned int z = 0; z < 8; z++) {
-                int index = z*64 + y*8 + x + offset;
-
-                //colors with max brightness set to 64
-                uint8_t red = ((*frame)[index]&0x60)>>1;
-                uint8_t green = ((*frame)[index]&0x1C)<<1;
-                uint8_t blue = ((*frame)[index]&0x03)<<4;
-                Color pixelColor = Color(red, green, blue);
-                cube.setVoxel(x, y, z, pixelColor);
-            }
-        }
-    }
-
+    cube.drawFrame(frame + offset);
     cube.show();
 }
 
 /**
- * Handle client requests and reply.
- * @param data string from client
- * @param result string to client
+ * Handle client requests.
+ * Messages of exactly one frame are raw pixels, anything else is a batch of
+ * drawing commands.
+ * @param data payload from client
+ * @param length payload length
  */
-void handle(String &data, String &result)
+void handle(uint8_t *data, int length)
 {
-    if(data.length() == 512) {
-        displayFrame(&data, 0);
+    if(length == PIXEL_COUNT) {
+        displayFrame(data, 0);
+    } else {
+        runCommands(cube, data, length);
     }
-
-    result += String(data.length());
 }
 
 void loop()
 {
     testTick();
+    // everything from here to the end of the loop is one frame, and should
+    // leave the heap alone (see frame-arena.h)
+    frameArena.startFrame();
+    // the one wait per loop, connections are accepted here
+    poller.poll();
     //info("pre doIt");
     mine.doIt();
     //info("post doIt");
+    usbLink.poll();
+    // UDP frames, and the clock sync with other cubes
+    cube.listen();
+    frameArena.endFrame();
 }
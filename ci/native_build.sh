@@ -0,0 +1,17 @@
+#!/bin/bash
+#
+# Builds each application that runs as a Linux process (native/makefile)
+# so breakage in the POSIX socket layer shows up without a core.
+ci_dir=$(dirname $BASH_SOURCE)
+cd $ci_dir
+
+. functions.sh
+
+cd ../native || die "Hey where's the ./native directory?"
+
+for app in websocket-streaming; do
+    make clean APP=$app > /dev/null
+    make all APP=$app > build-$app.log || die "Problem building native $app"
+    [ -x "obj/$app" ] || die "Couldn't find the native $app executable"
+    echo Native $app built.
+done
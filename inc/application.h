@@ -29,20 +29,28 @@
 #include "spark_wiring.h"
 #include "spark_wiring_interrupts.h"
 #include "spark_wiring_string.h"
+#include "spark_wiring_stringview.h"
 #include "spark_wiring_print.h"
+#ifndef SPARK_POSIX
 #include "spark_wiring_usartserial.h"
+#endif
 #include "spark_wiring_usbserial.h"
+#ifndef SPARK_POSIX
 #include "spark_wiring_spi.h"
 #include "spark_wiring_i2c.h"
 #include "spark_wiring_servo.h"
+#endif
 #include "spark_wiring_wifi.h"
 #include "spark_wiring_network.h"
 #include "spark_wiring_client.h"  
+#include "spark_wiring_poller.h"
 #include "spark_wiring_tcpclient.h"
 #include "spark_wiring_tcpserver.h"
 #include "spark_wiring_udp.h"
 #include "spark_wiring_time.h"
+#ifndef SPARK_POSIX
 #include "spark_wiring_tone.h"
 #include "spark_wiring_eeprom.h"
+#endif
 
 #endif /* APPLICATION_H_ */
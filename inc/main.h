@@ -71,6 +71,12 @@ extern "C" {
  */
 #define IWDG_RESET_ENABLE
 
+/*
+ * Check the stack guard zone on every SysTick and panic as soon as the stack
+ * reaches it, rather than letting it run on into the heap (stack_monitor.h)
+ */
+//#define STACK_GUARD_CHECK_ENABLE
+
 //#undef SPARK_WLAN_ENABLE
 
 /*
@@ -88,15 +94,38 @@ extern "C" {
  */
 //#define RGB_NOTIFICATIONS_CONNECTING_ONLY
 
-#define USART_RX_DATA_SIZE			256
+/*
+ * Ring of data waiting to go to the USB host, and how long a write waits
+ * for room in it before dropping the rest. A write never waits with
+ * interrupts off or from an interrupt handler, nor again once the host
+ * has stopped reading, until it reads again.
+ */
+#ifndef USART_RX_DATA_SIZE
+#define USART_RX_DATA_SIZE			512
+#endif
+#define USB_TX_TIMEOUT				5	/* ms */
+
+/*
+ * Ring of data received from the USB host, a power of two of at least two
+ * packets. The host is held off while a packet would not fit.
+ */
+#ifndef USB_RX_RING_SIZE
+#define USB_RX_RING_SIZE			512
+#endif
+#if USB_RX_RING_SIZE <= 0 || (USB_RX_RING_SIZE & (USB_RX_RING_SIZE - 1)) != 0
+#error "USB_RX_RING_SIZE must be a power of two"
+#endif
 
 /* Exported functions ------------------------------------------------------- */
 void Timing_Decrement(void);
 
 void USB_USART_Init(uint32_t baudRate);
-uint8_t USB_USART_Available_Data(void);
+uint32_t USB_USART_Available_Data(void);
 int32_t USB_USART_Receive_Data(void);
+uint32_t USB_USART_Peek_Data(const uint8_t **data);
+void USB_USART_Skip_Data(uint32_t count);
 void USB_USART_Send_Data(uint8_t Data);
+uint32_t USB_USART_Send_Buffer(const uint8_t *data, uint32_t length);
 void Handle_USBAsynchXfer(void);
 void Get_SerialNum(void);
 
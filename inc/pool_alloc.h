@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file    pool_alloc.h
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Header for pool_alloc.cpp module
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#ifndef __POOL_ALLOC_H
+#define __POOL_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Size classes for small allocations, smallest first. Each class is a fixed
+ * number of equal blocks reserved in RAM at link time, so allocating and
+ * freeing them is O(1) and they never fragment the heap. Block sizes are
+ * multiples of 8. Larger allocations, and small ones that find their class
+ * full, come from the heap as before.
+ */
+#define POOL_CLASSES		5
+#define POOL_BLOCK_SIZES	{ 16, 32, 64, 128, 256 }
+#define POOL_BLOCK_COUNTS	{ 16,  8,  8,   2,   2 }
+
+typedef struct pool_class_stats
+{
+	uint16_t block_size;
+	uint16_t blocks;		// blocks in the class
+	uint16_t in_use;		// blocks allocated now
+	uint16_t peak;			// most blocks ever allocated at once
+	uint32_t allocs;		// allocations served by the class
+	uint32_t overflows;		// allocations that found the class full
+} pool_class_stats_t;
+
+typedef struct heap_stats
+{
+	uint32_t heap_size;		// RAM taken by the heap now
+	uint32_t heap_high_water;	// most RAM ever taken by the heap
+	uint32_t free_total;		// free bytes in the heap and between it and the stack
+	uint32_t largest_free;		// the largest allocation sure to succeed
+	uint32_t allocs;		// allocations made, from the pools or the heap
+	uint32_t failed_allocs;		// allocations that returned NULL
+	pool_class_stats_t pools[POOL_CLASSES];
+} heap_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// malloc() and friends, taking small blocks from the pools
+void *pool_malloc(size_t size);
+void *pool_calloc(size_t count, size_t size);
+void *pool_realloc(void *ptr, size_t size);
+void pool_free(void *ptr);
+
+// Usable size of a block from pool_malloc(), 0 when it came from the heap
+size_t pool_block_size(const void *ptr);
+
+// Allocations made so far, so a caller can check a stretch of code made none
+uint32_t pool_alloc_count(void);
+
+// Fills in allocs, failed_allocs and the pool statistics
+void pool_stats(heap_stats_t *stats);
+
+// Fills in all the statistics, heap included (firmware builds only)
+void heap_stats(heap_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __POOL_ALLOC_H */
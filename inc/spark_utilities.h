@@ -27,11 +27,15 @@
 #ifndef __SPARK_UTILITIES_H
 #define __SPARK_UTILITIES_H
 
+#ifndef SPARK_POSIX
 #include "main.h"
+#endif
 #include "spark_wiring_string.h"
 #include "spark_wiring_time.h"
 #include "spark_wiring_interrupts.h"
+#ifndef SPARK_POSIX
 #include "spark_protocol.h"
+#endif
 
 #define BYTE_N(x,n)						(((x) >> n*8) & 0x000000FF)
 
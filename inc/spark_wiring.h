@@ -25,11 +25,15 @@
 
 #ifndef SPARK_WIRING_H
 #define SPARK_WIRING_H
+#ifdef SPARK_POSIX
+#include "spark_wiring_posix.h"
+#else
 #include "stm32f10x.h"
 #include "config.h"
 #include "spark_macros.h"
 #include "debug.h"
 #include "platform_config.h"
+#endif
 #include "spark_utilities.h"
 #include "spark_wiring_stream.h"
 #include "spark_wiring_printable.h"
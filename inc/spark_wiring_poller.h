@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_poller.h
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Header for spark_wiring_poller.cpp module
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#ifndef __SPARK_WIRING_POLLER_H
+#define __SPARK_WIRING_POLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define POLLER_MAX_SOCKETS	8
+#define POLLER_TIMEOUT		5000	// select() timeout in us, the CC3000 minimum
+
+class SocketPoller;
+
+/*
+ * A socket object that a SocketPoller can wait on. While registered, the
+ * object's own available()/parsePacket() checks stop waiting in select().
+ */
+class Pollable {
+public:
+	Pollable() : _poller(NULL) {}
+	Pollable(const Pollable&) : _poller(NULL) {}
+	Pollable& operator=(const Pollable&) { return *this; }	// Registration stays with the object
+	virtual ~Pollable();
+
+	virtual long pollSocket() = 0;	// Socket to wait on, negative for none
+	virtual void pollReady() = 0;	// Socket is readable, receive into the object's buffer
+
+protected:
+	SocketPoller* _poller;
+
+	friend class SocketPoller;
+};
+
+class SocketPoller {
+public:
+	SocketPoller();
+
+	bool add(Pollable &item);
+	void remove(Pollable &item);
+	int poll(uint32_t usec = POLLER_TIMEOUT);
+
+private:
+	Pollable* _items[POLLER_MAX_SOCKETS];
+	uint8_t _count;
+};
+
+// One select() over count sockets; sets ready[i] for each readable socket
+int socket_poll(const long *socks, uint8_t count, uint8_t *ready, uint32_t usec);
+
+#endif
@@ -28,6 +28,7 @@
 #define __SPARK_WIRING_PRINT_
 
 #include <stdio.h> // for size_t
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -42,12 +43,13 @@ const unsigned char OCT = 8;
 const unsigned char BIN = 2;
 
 class String;
+class StringView;
 
 class Print
 {
   private:
     int write_error;
-    size_t printNumber(unsigned long, uint8_t);
+    size_t printNumber(unsigned long, uint8_t, bool negative = false);
     size_t printFloat(double, uint8_t);
   protected:
     void setWriteError(int err = 1) { write_error = err; }
@@ -67,6 +69,7 @@ class Print
     
     size_t print(const String &);
     size_t print(const char[]);
+    size_t print(const StringView &);
     size_t print(char);
     size_t print(unsigned char, int = DEC);
     size_t print(int, int = DEC);
@@ -78,6 +81,7 @@ class Print
 
     size_t println(const String &s);
     size_t println(const char[]);
+    size_t println(const StringView &);
     size_t println(char);
     size_t println(unsigned char, int = DEC);
     size_t println(int, int = DEC);
@@ -87,6 +91,33 @@ class Print
     size_t println(double, int = 2);
     size_t println(const Printable&);
     size_t println(void);
+
+    // Formats into a small buffer on the stack and writes it in one piece,
+    // or in pieces of that size when longer. Never uses the heap. Handles
+    // %d %i %u %x %X %o %c %s %f and %%, with the flags '-', '0' and
+    // '+', a width, a precision (also given as *) and the l modifier.
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t vprintf(const char *format, va_list args);
+};
+
+/*
+ * Prints into a char array, which is always left terminated. What does
+ * not fit is dropped.
+ */
+class BufferPrint : public Print
+{
+  private:
+    char *buffer;
+    size_t size;
+    size_t length;
+  public:
+    BufferPrint(char *buffer, size_t size);
+
+    virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    const char *c_str() const { return buffer; }
+    size_t getLength() const { return length; }
 };
 
 #endif
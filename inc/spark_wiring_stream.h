@@ -35,6 +35,7 @@
 #include <ctype.h>
 #include "spark_wiring.h"
 #include "spark_wiring_string.h"
+#include "spark_wiring_stringview.h"
 #include "spark_wiring_print.h"
   
 // compatability macros for testing
@@ -55,6 +56,8 @@ class Stream : public Print
     int timedRead();    // private method to read stream with timeout
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(); // returns the next numeric digit in the stream or -1 if timeout
+    size_t timedPeekBuffer(const uint8_t *&data); // peekBuffer() waiting up to the timeout for data
+    uint8_t _peeked;             // the byte handed out by the default peekBuffer()
 
   public:
     virtual int available() = 0;
@@ -62,6 +65,15 @@ class Stream : public Print
     virtual int peek() = 0;
     virtual void flush() = 0;
 
+    // Bulk access to received data, which the readers and parsers below
+    // work through a chunk at a time. peekBuffer() points data at received
+    // bytes that can be read without waiting and returns how many there
+    // are, or 0 if there are none. consume() then discards that many or
+    // fewer. Streams with a receive buffer override both to hand out the
+    // buffer itself; the defaults go through peek() and read().
+    virtual size_t peekBuffer(const uint8_t *&data);
+    virtual void consume(size_t length);
+
     Stream() {_timeout=1000;}
 
 // parsing methods
@@ -97,6 +109,9 @@ class Stream : public Print
   String readString();
   String readStringUntil(char terminator);
 
+  StringView readStringUntil(char terminator, char *buffer, size_t length); // as readBytesUntil
+  // returns a view of the characters placed in the buffer, so lines can be parsed without the heap
+
   protected:
   long parseInt(char skipChar); // as above but the given skipChar is ignored
   // as above but the given skipChar is ignored
@@ -45,10 +45,21 @@
 class __FlashStringHelper;
 #define F(X) (X)
 
+// Number conversion without a terminator, for callers that build text in
+// their own buffers. Writes the digits of value in the given radix (2 or
+// more) so that they end just before end, and returns the first one.
+char *format_digits(unsigned long value, char *end, unsigned char radix, char letter = 'A');
+
+// Strings up to this length are held inside the String object itself, so
+// short values such as numbers and header names never touch the heap
+#define STRING_INLINE_SIZE 15
+
 // An inherited class for holding the result of a concatenation.  These
 // result objects are assumed to be writable by subsequent concatenations.
 class StringSumHelper;
 
+class StringView;
+
 // The string class
 class String
 {
@@ -70,6 +81,7 @@ public:
 	String(String &&rval);
 	String(StringSumHelper &&rval);
 	#endif
+	explicit String(const StringView &view);
 	explicit String(char c);
 	explicit String(unsigned char, unsigned char base=10);
 	explicit String(int, unsigned char base=10);
@@ -92,6 +104,7 @@ public:
 	// marked as invalid ("if (s)" will be false).
 	String & operator = (const String &rhs);
 	String & operator = (const char *cstr);
+	String & operator = (const StringView &view);
 	#ifdef __GXX_EXPERIMENTAL_CXX0X__
 	String & operator = (String &&rval);
 	String & operator = (StringSumHelper &&rval);
@@ -104,6 +117,7 @@ public:
 	// concatenation is considered unsucessful.  
 	unsigned char concat(const String &str);
 	unsigned char concat(const char *cstr);
+	unsigned char concat(const StringView &view);
 	unsigned char concat(char c);
 	unsigned char concat(unsigned char c);
 	unsigned char concat(int num);
@@ -117,6 +131,7 @@ public:
 	// will be left unchanged (but this isn't signalled in any way)
 	String & operator += (const String &rhs)	{concat(rhs); return (*this);}
 	String & operator += (const char *cstr)		{concat(cstr); return (*this);}
+	String & operator += (const StringView &view)	{concat(view); return (*this);}
 	String & operator += (char c)			{concat(c); return (*this);}
 	String & operator += (unsigned char num)		{concat(num); return (*this);}
 	String & operator += (int num)			{concat(num); return (*this);}
@@ -193,9 +208,11 @@ protected:
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
 	unsigned char flags;    // unused, for future features
+	char inlineBuffer[STRING_INLINE_SIZE + 1]; // buffer for short strings
 protected:
 	void init(void);
 	void invalidate(void);
+	unsigned char onHeap(void) const {return buffer && buffer != inlineBuffer;}
 	unsigned char changeBuffer(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_stringview.h
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Header for spark_wiring_stringview.cpp module
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#ifndef __SPARK_WIRING_STRINGVIEW_H
+#define __SPARK_WIRING_STRINGVIEW_H
+
+#include <string.h>
+
+class String;
+
+/*
+ * A view of characters held somewhere else, such as a stack buffer, a
+ * static buffer or a String. Nothing here allocates or copies, and the
+ * characters need not end in '\0'. The view is only valid while the
+ * characters it refers to are.
+ */
+class StringView
+{
+public:
+	StringView() : _data(""), _length(0) {}
+	StringView(const char *cstr) : _data(cstr ? cstr : ""), _length(cstr ? strlen(cstr) : 0) {}
+	StringView(const char *data, unsigned int length) : _data(data), _length(length) {}
+	StringView(const String &str);
+
+	inline const char *data(void) const {return _data;}
+	inline unsigned int length(void) const {return _length;}
+	char operator [] (unsigned int index) const {return index < _length ? _data[index] : 0;}
+
+	// comparison
+	unsigned char equals(const StringView &s) const;
+	unsigned char equalsIgnoreCase(const StringView &s) const;
+	unsigned char operator == (const StringView &rhs) const {return equals(rhs);}
+	unsigned char operator != (const StringView &rhs) const {return !equals(rhs);}
+	unsigned char startsWith(const StringView &prefix) const;
+	unsigned char startsWithIgnoreCase(const StringView &prefix) const;
+	unsigned char endsWith(const StringView &suffix) const;
+
+	// search
+	int indexOf(char ch, unsigned int fromIndex = 0) const;
+	StringView substring(unsigned int beginIndex) const;
+	StringView substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+	// the view without leading and trailing whitespace
+	StringView trim(void) const;
+
+	// returns the characters up to the first delimiter and moves this view
+	// past it, or returns the whole view and leaves this one empty
+	StringView split(char delimiter);
+
+	// copies the characters into buf, always ending in '\0'
+	void toCharArray(char *buf, unsigned int bufsize) const;
+
+	// parsing/conversion
+	long toInt(void) const;
+
+private:
+	const char *_data;
+	unsigned int _length;
+};
+
+#endif /* __SPARK_WIRING_STRINGVIEW_H */
@@ -28,15 +28,18 @@
 
 #include "spark_wiring_client.h"
 #include "spark_wiring.h"
+#include "spark_wiring_poller.h"
 
-#define TCPCLIENT_BUF_MAX_SIZE	128
+#define TCPCLIENT_BUF_MAX_SIZE	128	// Ring buffer, a power of 2
+#define TCPCLIENT_TX_BUF_SIZE	64	// Write-combining buffer, see setWriteBuffering()
+#define TCPCLIENT_POLL_TIMEOUT	5000	// select() timeout in us, the CC3000 minimum
 
-class TCPClient : public Client {
+class TCPClient : public Client, public Pollable {
 
 public:
 	TCPClient();
 	TCPClient(uint8_t sock);
-        virtual ~TCPClient() {};
+        virtual ~TCPClient();
 
   uint8_t status();
 	virtual int connect(IPAddress ip, uint16_t port);
@@ -46,23 +49,46 @@ public:
 	virtual int available();
 	virtual int read();
 	virtual int read(uint8_t *buffer, size_t size);
+	int readFully(uint8_t *buffer, size_t size);
 	virtual int peek();
+	virtual size_t peekBuffer(const uint8_t *&data);
+	virtual void consume(size_t length);
 	virtual void flush();
 	virtual void stop();
 	virtual uint8_t connected();
 	virtual operator bool();
 
+	void setPollTimeout(uint32_t usec);
+	void setWriteBuffering(bool enable);
+	static void flushAll();
+
+	virtual long pollSocket();
+	virtual void pollReady();
+
 	friend class TCPServer;
 
 	using Print::write;
 
 private:
 	static uint16_t _srcport;
+	static TCPClient* _writers[MAX_SOCK_NUM];	// Clients holding unsent writes, by socket
+	static uint8_t _closeCount[MAX_SOCK_NUM];	// Bumped by stop(), tells reused sockets apart
+	static system_tick_t _lastReceive[MAX_SOCK_NUM];	// millis() of the last data received, by socket
 	long _sock;
 	uint8_t _buffer[TCPCLIENT_BUF_MAX_SIZE];
-	uint16_t _offset;
-	uint16_t _total;
+	uint16_t _offset;	// Ring index of the next byte to read
+	uint16_t _total;	// Bytes held in the ring
+	uint8_t _txBuffer[TCPCLIENT_TX_BUF_SIZE];
+	uint16_t _txCount;
+	bool _txBuffered;
+	uint32_t _pollTimeout;
+	bool _nonBlocking;
 	inline int bufferCount();
+	int bufferRead(uint8_t *buffer, size_t size);
+	bool poll();
+	void fill();
+	int receive(uint8_t *buffer, size_t size);
+	void sendPending();
 };
 
 #endif
@@ -27,23 +27,41 @@
 #define __SPARK_WIRING_TCPSERVER_H
 
 #include "spark_wiring.h"
+#include "spark_wiring_poller.h"
+
+#define TCPSERVER_MAX_CLIENTS	4	// Live connections kept per server
+#define TCPSERVER_IDLE_TIMEOUT	10000	// ms without data before a connection may be evicted
 
 class TCPClient;
 
-class TCPServer : public Print {
+class TCPServer : public Print, public Pollable {
 private:
 	uint16_t _port;
 	long _sock;
-	TCPClient _client;
+	long _pending;	// Connection accepted by pollReady(), not yet returned
+	struct {
+		long sock;
+		uint8_t closeCount;	// TCPClient::_closeCount[sock] when accepted
+	} _clients[TCPSERVER_MAX_CLIENTS];
+	uint8_t _count;
+
+	int acceptClient();
+	bool evictIdle();
 
 public:
 	TCPServer(uint16_t);
 
 	TCPClient available();
+	TCPClient accept();
+	uint8_t clients();
+	TCPClient client(uint8_t index);
 	virtual void begin();
 	virtual size_t write(uint8_t);
 	virtual size_t write(const uint8_t *buf, size_t size);
 
+	virtual long pollSocket();
+	virtual void pollReady();
+
 	using Print::write;
 };
 
@@ -28,10 +28,14 @@
 #define __SPARK_WIRING_UDP_H
 
 #include "spark_wiring.h"
+#include "spark_wiring_poller.h"
 
-#define RX_BUF_MAX_SIZE	512
+#define RX_BUF_MAX_SIZE	512	// Default buffer for parsePacket() and read(), see setBuffer()
+#ifndef UDP_TX_BUF_SIZE
+#define UDP_TX_BUF_SIZE	128	// Datagram assembled between beginPacket() and endPacket()
+#endif
 
-class UDP : public Stream {
+class UDP : public Stream, public Pollable {
 private:
 	uint8_t _sock;
 	uint16_t _port;
@@ -39,11 +43,23 @@ private:
 	uint16_t _remotePort;
 	sockaddr _remoteSockAddr;
 	socklen_t _remoteSockAddrLen;
-	uint8_t _buffer[RX_BUF_MAX_SIZE];
+	uint8_t *_buffer;
+	uint16_t _bufferSize;
+	bool _bufferOwned;
 	uint16_t _offset;
         uint16_t _total;
+	uint8_t _txBuffer[UDP_TX_BUF_SIZE];
+	uint16_t _txCount;
+	bool _txSent;
+	bool _nonBlocking;
+	bool poll();
+	bool reserveBuffer();
+	int receive(uint8_t *buffer, size_t size);
 public:
 	UDP();
+	virtual ~UDP();
+
+	bool setBuffer(size_t size, uint8_t *buffer = NULL);
 
 	virtual uint8_t begin(uint16_t);
 	virtual void stop();
@@ -53,15 +69,21 @@ public:
 	virtual size_t write(uint8_t);
 	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual int parsePacket();
+	int receivePacket(uint8_t *buffer, size_t size);
 	virtual int available();
 	virtual int read();
 	virtual int read(unsigned char* buffer, size_t len);
 	virtual int read(char* buffer, size_t len) { return read((unsigned char*)buffer, len); };
 	virtual int peek();
+	virtual size_t peekBuffer(const uint8_t *&data);
+	virtual void consume(size_t length);
 	virtual void flush();
 	virtual IPAddress remoteIP() { return _remoteIP; };
 	virtual uint16_t remotePort() { return _remotePort; };
 
+	virtual long pollSocket();
+	virtual void pollReady();
+
 	using Print::write;
 };
 
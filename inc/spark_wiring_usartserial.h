@@ -29,13 +29,23 @@
 
 #include "spark_wiring_stream.h"
 
-#define SERIAL_BUFFER_SIZE 64
+// Ring buffer sizes, each port has one of each. Define them on the
+// command line to override.
+#ifndef SERIAL_RX_BUFFER_SIZE
+#define SERIAL_RX_BUFFER_SIZE 256
+#endif
+#ifndef SERIAL_TX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE 128
+#endif
 
 typedef struct Ring_Buffer
 {
-  unsigned char buffer[SERIAL_BUFFER_SIZE];
+  unsigned char *buffer;
+  unsigned int size;
   volatile unsigned int head;
   volatile unsigned int tail;
+  volatile uint32_t dropped;    // bytes lost because the ring was full
+  volatile uint32_t overruns;   // bytes lost before the interrupt could read them
 } Ring_Buffer;
 
 typedef enum USART_Num_Def {
@@ -58,10 +68,19 @@ typedef struct STM32_USART_Info {
 
   uint32_t usart_pin_remap;
 
+  // DMA channels of the USART, NULL where they serve something else
+  DMA_Channel_TypeDef* usart_tx_dma;
+  DMA_Channel_TypeDef* usart_rx_dma;
+  IRQn usart_rx_dma_int_n;
+
   // Buffer pointers. These need to be global for IRQ handler access
   Ring_Buffer* usart_tx_buffer;
   Ring_Buffer* usart_rx_buffer;
 
+  // DMA state, set up by beginDMA()
+  bool usart_dma;
+  volatile unsigned int usart_tx_dma_length;  // bytes in the transfer under way
+
 } STM32_USART_Info;
 extern STM32_USART_Info USART_MAP[TOTAL_USARTS];
 
@@ -75,6 +94,8 @@ class USARTSerial : public Stream
     bool transmitting;
     Ring_Buffer _rx_buffer;
     Ring_Buffer _tx_buffer;
+    unsigned char _rx_data[SERIAL_RX_BUFFER_SIZE];
+    unsigned char _tx_data[SERIAL_TX_BUFFER_SIZE];
     STM32_USART_Info *usartMap; // pointer to USART_MAP[] containing USART peripheral register locations (etc)
 
   public:
@@ -82,20 +103,27 @@ class USARTSerial : public Stream
     virtual ~USARTSerial() {};
     void begin(unsigned long);
     void begin(unsigned long, uint8_t);
+    bool beginDMA(void);
     void end();
 
     virtual int available(void);
     virtual int peek(void);
     virtual int read(void);
+    virtual size_t peekBuffer(const uint8_t *&data);
+    virtual void consume(size_t length);
     virtual void flush(void);
     virtual size_t write(uint8_t);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    uint32_t rxDropped(void);
+    uint32_t rxOverruns(void);
 
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
     inline size_t write(int n) { return write((uint8_t)n); }
 
-    using Print::write; // pull in write(str) and write(buf, size) from Print
+    using Print::write; // pull in write(str) from Print
 
     operator bool();
 
@@ -42,17 +42,23 @@ public:
 	int peek();
 
 	virtual size_t write(uint8_t byte);
+	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual int read();
 	virtual int available();
+	virtual size_t peekBuffer(const uint8_t *&data);
+	virtual void consume(size_t length);
 	virtual void flush();
 
 	using Print::write;
 };
 
 extern void USB_USART_Init(uint32_t baudRate);
-extern uint8_t USB_USART_Available_Data(void);
+extern uint32_t USB_USART_Available_Data(void);
 extern int32_t USB_USART_Receive_Data(void);
+extern uint32_t USB_USART_Peek_Data(const uint8_t **data);
+extern void USB_USART_Skip_Data(uint32_t count);
 extern void USB_USART_Send_Data(uint8_t Data);
+extern uint32_t USB_USART_Send_Buffer(const uint8_t *data, uint32_t length);
 
 extern USBSerial Serial;
 
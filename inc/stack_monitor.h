@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @file    stack_monitor.h
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Header for stack_monitor.cpp module
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+
+#ifndef __STACK_MONITOR_H
+#define __STACK_MONITOR_H
+
+#include <stdint.h>
+
+/*
+ * The stack is painted with STACK_PAINT at boot, and the lowest word that
+ * no longer holds it marks the deepest the stack has reached since. The
+ * bottom STACK_GUARD_SIZE bytes are the guard zone, checked on each SysTick
+ * when STACK_GUARD_CHECK_ENABLE is defined (main.h). Interrupt handlers run
+ * on the same stack, so their use is counted too.
+ */
+#define STACK_PAINT		0xC5C5C5C5
+#define STACK_GUARD_SIZE	64
+
+typedef struct stack_stats
+{
+	uint32_t size;			// bytes reserved for the stack
+	uint32_t in_use;		// bytes used by the caller now
+	uint32_t high_water;		// most bytes ever used
+	uint32_t headroom;		// least bytes ever left, guard zone included
+} stack_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Paints the stack below the caller, before anything else runs
+void stack_paint(void);
+
+// Fills in the stack statistics (firmware builds only)
+void stack_stats(stack_stats_t *stats);
+
+// The least the stack has had left, in bytes
+uint32_t stack_headroom(void);
+
+// Panics when the stack has reached its guard zone
+void stack_guard_check(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __STACK_MONITOR_H */
@@ -0,0 +1,105 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_posix.h
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Native (Linux) stand-ins for the core-common-lib and CC3000
+ *          definitions used by the wiring library
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#ifndef __SPARK_WIRING_POSIX_H
+#define __SPARK_WIRING_POSIX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+// spark_wiring_ipaddress.h declares its own INADDR_NONE
+#undef INADDR_NONE
+
+typedef uint32_t system_tick_t;
+
+#define __IO volatile
+
+#define arraySize(a) (sizeof((a))/sizeof((a[0])))
+
+// Debug output is off, but the arguments still count as used
+static inline void posix_debug(const char *fmt, ...) {}
+#define DEBUG(fmt, ...) posix_debug(fmt, ##__VA_ARGS__)
+
+/*
+ * Pins. There is no GPIO, PIN_MAP only tells pins apart.
+ */
+typedef struct GPIO_TypeDef GPIO_TypeDef;
+typedef struct TIM_TypeDef TIM_TypeDef;
+
+/*
+ * Sockets. These are file descriptors, so MAX_SOCK_NUM is the "no socket"
+ * value of a uint8_t socket member and sizes the per-socket tables. The
+ * wiring classes close and refuse any socket they are given at or beyond it.
+ */
+#define MAX_SOCK_NUM 255
+
+typedef fd_set _types_fd_set_cc3000;
+
+// CC3000 socket options, handled by posix_setsockopt()
+#define SOCKOPT_RECV_NONBLOCK   0x7F01
+#define SOCKOPT_ACCEPT_NONBLOCK 0x7F02
+#define SOCK_ON                 0
+#define SOCK_OFF                1
+
+#define SOCKET_STATUS_ACTIVE    0
+#define SOCKET_STATUS_INACTIVE  1
+
+#define closesocket(sd) close(sd)
+#define setsockopt(sd, level, optname, optval, optlen) posix_setsockopt(sd, level, optname, optval, optlen)
+
+int posix_setsockopt(long sd, long level, long optname, const void *optval, socklen_t optlen);
+long get_socket_active_status(long sd);
+int gethostbyname(const char *hostname, uint16_t nameLen, uint32_t *ip);
+
+/*
+ * WLAN. The host network is always up.
+ */
+#define S2M(s) ((s) * 1000)
+#define MAX_SEC_WAIT_CONNECT 8
+
+inline uint32_t SPARK_WLAN_SetNetWatchDog(uint32_t timeOutInMS)
+{
+	return 0;
+}
+
+/*
+ * Cloud
+ */
+typedef void (*EventHandler)(const char *eventName, const char *data);
+
+/*
+ * LED output. Stands in for the strip, keeping each frame shown in memory.
+ */
+void Native_Show_Pixels(const uint8_t *pixels, uint16_t length);
+
+#endif /* __SPARK_WIRING_POSIX_H */
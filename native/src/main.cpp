@@ -0,0 +1,101 @@
+/**
+ ******************************************************************************
+ * @file    main.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Main program body for the native (Linux) build
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#include <signal.h>
+#include <stdio.h>
+
+#include "application.h"
+
+// time between frame rate reports on stderr, in milliseconds
+#define REPORT_INTERVAL 5000
+
+#define CAPTURE_SIZE (512 * 3)
+
+// The last frame shown, and how many frames were shown
+static uint8_t capture[CAPTURE_SIZE];
+static uint32_t framesShown;
+
+// Every frame is also appended here when a file is named on the command line
+static FILE *captureFile;
+
+void Native_Show_Pixels(const uint8_t *pixels, uint16_t length)
+{
+	if (length > CAPTURE_SIZE)
+	{
+		length = CAPTURE_SIZE;
+	}
+	memcpy(capture, pixels, length);
+	framesShown++;
+
+	if (captureFile)
+	{
+		fwrite(pixels, 1, length, captureFile);
+	}
+}
+
+static void report(void)
+{
+	static system_tick_t lastReport;
+	static uint32_t lastFrames;
+
+	system_tick_t now = millis();
+	if (now - lastReport < REPORT_INTERVAL)
+	{
+		return;
+	}
+
+	fprintf(stderr, "frames %lu, %lu/s\n", (unsigned long)framesShown,
+			(unsigned long)(framesShown - lastFrames) * 1000 / (now - lastReport));
+	lastReport = now;
+	lastFrames = framesShown;
+}
+
+/*******************************************************************************
+ * Function Name  : main.
+ * Description    : Runs setup() then loop() until the process is killed. An
+ *                  optional argument names a file that receives every frame.
+ *******************************************************************************/
+int main(int argc, char *argv[])
+{
+	// A client that drops its connection must not end the process
+	signal(SIGPIPE, SIG_IGN);
+	// Serial output reaches logs as it is printed
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (argc > 1 && !(captureFile = fopen(argv[1], "wb")))
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	setup();
+
+	while (1)
+	{
+		loop();
+		TCPClient::flushAll();
+		report();
+	}
+}
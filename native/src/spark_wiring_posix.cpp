@@ -0,0 +1,315 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_posix.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Wiring platform for the native (Linux) build: CC3000 socket calls
+ *          on POSIX sockets, timing, and stubs for pins, WiFi and the cloud
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "application.h"
+#include "pool_alloc.h"
+#include "stack_monitor.h"
+
+/*
+ * Sockets
+ */
+
+#undef setsockopt
+
+/*
+ * The CC3000 non-blocking options become O_NONBLOCK. Listening sockets
+ * also get SO_REUSEADDR, so a restarted process can bind its port at once.
+ */
+int posix_setsockopt(long sd, long level, long optname, const void *optval, socklen_t optlen)
+{
+	if (optname != SOCKOPT_RECV_NONBLOCK && optname != SOCKOPT_ACCEPT_NONBLOCK)
+	{
+		return setsockopt(sd, level, optname, optval, optlen);
+	}
+
+	if (optname == SOCKOPT_ACCEPT_NONBLOCK)
+	{
+		int reuse = 1;
+		setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	}
+
+	int flags = fcntl(sd, F_GETFL, 0);
+	if (flags < 0)
+	{
+		return -1;
+	}
+	if (*(const long*)optval == SOCK_ON)
+	{
+		flags |= O_NONBLOCK;
+	}
+	else
+	{
+		flags &= ~O_NONBLOCK;
+	}
+	return fcntl(sd, F_SETFL, flags);
+}
+
+// Inactive once the peer has closed, like the CC3000 CLOSE_WAIT event
+long get_socket_active_status(long sd)
+{
+	char c;
+	ssize_t ret = recv(sd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+	if (ret > 0 || (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
+	{
+		return SOCKET_STATUS_ACTIVE;
+	}
+	return SOCKET_STATUS_INACTIVE;
+}
+
+// IPv4 address of hostname in host byte order, > 0 on success
+int gethostbyname(const char *hostname, uint16_t nameLen, uint32_t *ip)
+{
+	addrinfo hints;
+	addrinfo *result;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+
+	if (getaddrinfo(hostname, NULL, &hints, &result) != 0)
+	{
+		return -1;
+	}
+	*ip = ntohl(((sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+	freeaddrinfo(result);
+	return 1;
+}
+
+long socket_connect(long sd, const sockaddr *addr, long addrlen)
+{
+	return connect(sd, addr, addrlen);
+}
+
+/*
+ * Timing
+ */
+
+static uint64_t monotonicMicros(void)
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static const uint64_t startMicros = monotonicMicros();
+
+system_tick_t millis(void)
+{
+	return (monotonicMicros() - startMicros) / 1000;
+}
+
+unsigned long micros(void)
+{
+	return monotonicMicros() - startMicros;
+}
+
+void delay(unsigned long ms)
+{
+	usleep(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	usleep(us);
+}
+
+/*
+ * Pins. Inputs read LOW and nothing ever interrupts.
+ */
+
+STM32_Pin_Info PIN_MAP[TOTAL_PINS];
+
+void pinMode(uint16_t pin, PinMode mode)
+{
+}
+
+void digitalWrite(uint16_t pin, uint8_t value)
+{
+}
+
+int32_t digitalRead(uint16_t pin)
+{
+	return LOW;
+}
+
+void attachInterrupt(uint16_t pin, voidFuncPtr handler, InterruptMode mode)
+{
+}
+
+void detachInterrupt(uint16_t pin)
+{
+}
+
+void interrupts(void)
+{
+}
+
+void noInterrupts(void)
+{
+}
+
+/*
+ * WiFi. The host network is always ready.
+ */
+
+WiFiClass WiFi;
+
+bool WiFiClass::ready(void)
+{
+	return true;
+}
+
+void WiFiClass::listen(void)
+{
+}
+
+IPAddress WiFiClass::localIP()
+{
+	return IPAddress(127, 0, 0, 1);
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac)
+{
+	memset(mac, 0, 6);
+	return mac;
+}
+
+/*
+ * Cloud. Variables and functions are accepted and never called.
+ */
+
+System_Mode_TypeDef SystemClass::_mode = MANUAL;
+
+SystemClass System;
+SparkClass Spark;
+
+SystemClass::SystemClass()
+{
+}
+
+void SystemClass::bootloader(void)
+{
+}
+
+void SparkClass::variable(const char *varKey, void *userVar, Spark_Data_TypeDef userVarType)
+{
+}
+
+void SparkClass::function(const char *funcKey, int (*pFunc)(String paramString))
+{
+}
+
+void SparkClass::connect(void)
+{
+}
+
+void SparkClass::disconnect(void)
+{
+}
+
+/*
+ * Serial output goes to stdout, there is no input.
+ */
+
+USBSerial Serial;
+
+USBSerial::USBSerial()
+{
+}
+
+void USBSerial::begin(long speed)
+{
+}
+
+void USBSerial::end()
+{
+}
+
+int USBSerial::peek()
+{
+	return -1;
+}
+
+size_t USBSerial::write(uint8_t byte)
+{
+	return putchar(byte) == EOF ? 0 : 1;
+}
+
+size_t USBSerial::write(const uint8_t *buffer, size_t size)
+{
+	return fwrite(buffer, 1, size, stdout);
+}
+
+int USBSerial::read()
+{
+	return -1;
+}
+
+int USBSerial::available()
+{
+	return 0;
+}
+
+size_t USBSerial::peekBuffer(const uint8_t *&data)
+{
+	return 0;
+}
+
+void USBSerial::consume(size_t length)
+{
+}
+
+void USBSerial::flush()
+{
+	fflush(stdout);
+}
+
+/*
+ * The process has no painted stack or heap of its own to report, only the
+ * pools.
+ */
+
+void stack_stats(stack_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+uint32_t stack_headroom(void)
+{
+	return 0;
+}
+
+void heap_stats(heap_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	pool_stats(stats);
+}
@@ -30,6 +30,8 @@
 #include "main.h"
 #include "debug.h"
 #include "spark_utilities.h"
+#include "spark_wiring_tcpclient.h"
+#include "stack_monitor.h"
 extern "C" {
 #include "usb_conf.h"
 #include "usb_lib.h"
@@ -49,13 +51,26 @@ extern "C" {
 volatile uint32_t TimingFlashUpdateTimeout;
 
 uint8_t  USART_Rx_Buffer[USART_RX_DATA_SIZE];
-uint32_t USART_Rx_ptr_in = 0;
-uint32_t USART_Rx_ptr_out = 0;
+volatile uint32_t USART_Rx_ptr_in = 0;
+volatile uint32_t USART_Rx_ptr_out = 0;
 uint32_t USART_Rx_length  = 0;
 
+/* Set when a write gave up waiting for the host, cleared when it reads */
+volatile uint8_t USB_Tx_Stalled = 0;
+uint32_t USB_Tx_Dropped = 0;
+
 uint8_t USB_Rx_Buffer[VIRTUAL_COM_PORT_DATA_SIZE];
 uint16_t USB_Rx_length = 0;
-uint16_t USB_Rx_ptr = 0;
+
+/* Packets from the host, queued by EP3_OUT_Callback. The positions run
+ * freely and are taken modulo the ring size when indexing */
+#if USB_RX_RING_SIZE < 2 * VIRTUAL_COM_PORT_DATA_SIZE
+#error "USB_RX_RING_SIZE must hold at least two packets"
+#endif
+uint8_t USB_Rx_Ring[USB_RX_RING_SIZE];
+volatile uint32_t USB_Rx_ring_in = 0;
+volatile uint32_t USB_Rx_ring_out = 0;
+uint32_t USB_Rx_Dropped = 0;
 
 uint8_t  USB_Tx_State = 0;
 uint8_t  USB_Rx_State = 0;
@@ -81,6 +96,9 @@ extern LINE_CODING linecoding;
 extern "C" void SparkCoreConfig(void)
 {
         DECLARE_SYS_HEALTH(ENTERED_SparkCoreConfig);
+	/* Paint the stack for its high-water mark, while nothing is on it */
+	stack_paint();
+
 #ifdef DFU_BUILD_ENABLE
 	/* Set the Vector Table(VT) base location at 0x5000 */
 	NVIC_SetVectorTable(NVIC_VectTab_FLASH, 0x5000);
@@ -200,6 +218,7 @@ int main(void)
 					//Execute user application loop
 			                DECLARE_SYS_HEALTH(ENTERED_Loop);
 					loop();
+					TCPClient::flushAll();
                                         DECLARE_SYS_HEALTH(RAN_Loop);
 				}
 #ifdef SPARK_WLAN_ENABLE
@@ -339,20 +358,38 @@ void USB_USART_Init(uint32_t baudRate)
 	USB_Init();
 }
 
+/*******************************************************************************
+ * Function Name  : USB_USART_Resume_Receive.
+ * Description    : Let the host send again once a packet fits in the ring.
+ *                  EP3_OUT_Callback holds the endpoint off (USB_Rx_State = 1)
+ *                  when it does not, so the flag is ours until then.
+ * Input          : None.
+ * Return         : None.
+ *******************************************************************************/
+static void USB_USART_Resume_Receive(void)
+{
+	uint32_t used = USB_Rx_ring_in - USB_Rx_ring_out;
+
+	if(USB_Rx_State == 1 && USB_RX_RING_SIZE - used >= VIRTUAL_COM_PORT_DATA_SIZE)
+	{
+		USB_Rx_State = 0;
+
+		/* Enable the receive of data on EP3 */
+		SetEPRxValid(ENDP3);
+	}
+}
+
 /*******************************************************************************
  * Function Name  : USB_USART_Available_Data.
  * Description    : Return the length of available data received from USB.
  * Input          : None.
  * Return         : Length.
  *******************************************************************************/
-uint8_t USB_USART_Available_Data(void)
+uint32_t USB_USART_Available_Data(void)
 {
 	if(bDeviceState == CONFIGURED)
 	{
-		if(USB_Rx_State == 1)
-		{
-			return (USB_Rx_length - USB_Rx_ptr);
-		}
+		return USB_Rx_ring_in - USB_Rx_ring_out;
 	}
 
 	return 0;
@@ -366,23 +403,50 @@ uint8_t USB_USART_Available_Data(void)
  *******************************************************************************/
 int32_t USB_USART_Receive_Data(void)
 {
-	if(bDeviceState == CONFIGURED)
+	if(USB_USART_Available_Data() == 0)
 	{
-		if(USB_Rx_State == 1)
-		{
-			if((USB_Rx_length - USB_Rx_ptr) == 1)
-			{
-				USB_Rx_State = 0;
+		return -1;
+	}
 
-				/* Enable the receive of data on EP3 */
-				SetEPRxValid(ENDP3);
-			}
+	uint8_t data = USB_Rx_Ring[USB_Rx_ring_out % USB_RX_RING_SIZE];
+	USB_Rx_ring_out++;
+	USB_USART_Resume_Receive();
 
-			return USB_Rx_Buffer[USB_Rx_ptr++];
-		}
+	return data;
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Peek_Data.
+ * Description    : Point to the data received from USB and not yet read, up
+ *                  to where the ring wraps.
+ * Input          : Pointer to set to the data.
+ * Return         : Length.
+ *******************************************************************************/
+uint32_t USB_USART_Peek_Data(const uint8_t **data)
+{
+	uint32_t available = USB_USART_Available_Data();
+	uint32_t start = USB_Rx_ring_out % USB_RX_RING_SIZE;
+
+	*data = &USB_Rx_Ring[start];
+	if(available > USB_RX_RING_SIZE - start)
+	{
+		available = USB_RX_RING_SIZE - start;
 	}
+	return available;
+}
 
-	return -1;
+/*******************************************************************************
+ * Function Name  : USB_USART_Skip_Data.
+ * Description    : Discard data received from USB, as if it had been read.
+ * Input          : Number of bytes.
+ * Return         : None.
+ *******************************************************************************/
+void USB_USART_Skip_Data(uint32_t count)
+{
+	uint32_t available = USB_USART_Available_Data();
+
+	USB_Rx_ring_out += count < available ? count : available;
+	USB_USART_Resume_Receive();
 }
 
 /*******************************************************************************
@@ -393,24 +457,84 @@ int32_t USB_USART_Receive_Data(void)
  *******************************************************************************/
 void USB_USART_Send_Data(uint8_t Data)
 {
-	if(bDeviceState == CONFIGURED)
+	USB_USART_Send_Buffer(&Data, 1);
+}
+
+/*******************************************************************************
+ * Function Name  : USB_USART_Send_Buffer.
+ * Description    : Queue data for the USB Host, copying as much as fits into
+ *                  the ring at a time. When the ring is full, waits up to
+ *                  USB_TX_TIMEOUT ms for the host to make room, then drops
+ *                  the rest. Data already queued is never overwritten.
+ * Input          : Data and its length.
+ * Return         : Number of bytes queued.
+ *******************************************************************************/
+uint32_t USB_USART_Send_Buffer(const uint8_t *data, uint32_t length)
+{
+	uint32_t queued = 0;
+	uint32_t lastProgress = GetSystem1MsTick();
+
+	if(bDeviceState != CONFIGURED)
+	{
+		return 0;
+	}
+
+	/* The ring only drains from the USB interrupt */
+	bool canWait = !(__get_PRIMASK() & 1) && !(SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
+
+	while(queued < length)
 	{
-		USART_Rx_Buffer[USART_Rx_ptr_in] = Data;
+		uint32_t in = USART_Rx_ptr_in;
+		uint32_t out = USART_Rx_ptr_out;
+		uint32_t room;
 
-		USART_Rx_ptr_in++;
+		if(out == USART_RX_DATA_SIZE)
+		{
+			out = 0;
+		}
+
+		/* One byte is left free, so that a full ring differs from an empty one */
+		if(out > in)
+		{
+			room = out - in - 1;
+		}
+		else
+		{
+			room = USART_RX_DATA_SIZE - in - (out == 0 ? 1 : 0);
+		}
 
-		/* To avoid buffer overflow */
-		if(USART_Rx_ptr_in == USART_RX_DATA_SIZE)
+		if(room == 0)
 		{
-			USART_Rx_ptr_in = 0;
+			if(!canWait || USB_Tx_Stalled)
+			{
+				break;
+			}
+			if(GetSystem1MsTick() - lastProgress >= USB_TX_TIMEOUT)
+			{
+				USB_Tx_Stalled = 1;
+				break;
+			}
+			continue;
 		}
 
-		if(CC3000_Read_Interrupt_Pin())
+		if(room > length - queued)
 		{
-			//Delay 100us to avoid losing the data
-			Delay_Microsecond(100);
+			room = length - queued;
 		}
+		memcpy(&USART_Rx_Buffer[in], data + queued, room);
+		queued += room;
+
+		in += room;
+		if(in == USART_RX_DATA_SIZE)
+		{
+			in = 0;
+		}
+		USART_Rx_ptr_in = in;
+		lastProgress = GetSystem1MsTick();
 	}
+
+	USB_Tx_Dropped += length - queued;
+	return queued;
 }
 
 /*******************************************************************************
@@ -28,7 +28,10 @@
 
 /* Define abort() */
 #include <stdlib.h>
+#include <errno.h>
+#include <malloc.h>
 #include "debug.h"
+#include "pool_alloc.h"
 #ifdef __CS_SOURCERYGXX_REV__
 #define abort() _exit(-1);
 #include <errno.h>
@@ -74,27 +77,32 @@ void *__dso_handle = NULL;
 }
 
 /*
- * Implement C++ new/delete operators using the heap
+ * Implement C++ new/delete operators using the pools, which fall back on
+ * the heap. new has no way to report failure, so it panics instead.
  */
 
 void *operator new(size_t size)
 {
-	return malloc(size);
+	void *p = pool_malloc(size);
+	if (p == NULL) {
+		PANIC(OutOfHeap,"Out Of Heap");
+	}
+	return p;
 }
 
 void *operator new[](size_t size)
 {
-	return malloc(size);
+	return operator new(size);
 }
 
 void operator delete(void *p)
 {
-	free(p);
+	pool_free(p);
 }
 
 void operator delete[](void *p)
 {
-	free(p);
+	pool_free(p);
 }
 
 extern "C" {
@@ -114,8 +122,9 @@ void _exit(int status)
 /*
  * _sbrk() -  allocate incr bytes of memory from the heap.
  *
- *            Return a pointer to the memory, or abort if there
- *            is insufficient memory available on the heap.
+ *            Return a pointer to the memory, or -1 with errno set
+ *            to ENOMEM if there is insufficient memory available
+ *            on the heap, so malloc() returns NULL.
  *
  *            The heap is all the RAM that exists between _end and
  *            __Stack_Init, both of which are calculated by the linker.
@@ -127,22 +136,45 @@ void _exit(int status)
  *            __Stack_Init marks the bottom of the stack, as reserved
  *            in the linker script (../linker/linker_stm32f10x_md*.ld)
  */
+extern char _end, __Stack_Init;
+static char *heap_end = &_end;
+static char *heap_high_water = &_end;
+
 caddr_t _sbrk(int incr)
 {
-	extern char _end, __Stack_Init;
-	static char *heap_end = &_end;
 	char *prev_heap_end = heap_end;
 
-	heap_end += incr;
+	if (incr > &__Stack_Init - heap_end) {
+		errno = ENOMEM;
+		return (caddr_t) -1;
+	}
 
-	if (heap_end > &__Stack_Init) {
-	        PANIC(OutOfHeap,"Out Of Heap");
-		abort();
+	heap_end += incr;
+	if (heap_end > heap_high_water) {
+		heap_high_water = heap_end;
 	}
 
 	return (caddr_t) prev_heap_end;
 }
 
+/*
+ * heap_stats() - the pool statistics, and how much RAM the heap takes now
+ *                and at most. What lies between the heap and the stack
+ *                can always be allocated, so that is the largest free
+ *                block reported; freed blocks inside the heap add to the
+ *                total free.
+ */
+void heap_stats(heap_stats_t *stats)
+{
+	struct mallinfo info = mallinfo();
+
+	pool_stats(stats);
+	stats->heap_size = heap_end - &_end;
+	stats->heap_high_water = heap_high_water - &_end;
+	stats->largest_free = &__Stack_Init - heap_end;
+	stats->free_total = stats->largest_free + info.fordblks;
+}
+
 /* Bare metal, no processes, so error */
 int _kill(int pid, int sig)
 {
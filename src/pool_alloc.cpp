@@ -0,0 +1,233 @@
+/**
+ ******************************************************************************
+ * @file    pool_alloc.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Fixed-block pools for small allocations, falling back to the heap
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pool_alloc.h"
+
+static constexpr uint16_t blockSizes[POOL_CLASSES] = POOL_BLOCK_SIZES;
+static constexpr uint16_t blockCounts[POOL_CLASSES] = POOL_BLOCK_COUNTS;
+
+static constexpr size_t arenaSize(int poolClass)
+{
+	return poolClass == POOL_CLASSES ? 0 :
+		blockSizes[poolClass] * blockCounts[poolClass] + arenaSize(poolClass + 1);
+}
+
+// The blocks of every class, each class following the one before
+static uint64_t arena[arenaSize(0) / sizeof(uint64_t)];
+
+// A free block holds the next free block of its class
+typedef struct pool_block
+{
+	struct pool_block *next;
+} pool_block_t;
+
+static pool_block_t *freeList[POOL_CLASSES];
+static uint8_t *classStart[POOL_CLASSES + 1];	// the last entry is the arena end
+static pool_class_stats_t classStats[POOL_CLASSES];
+static uint32_t allocCount;
+static uint32_t failedAllocs;
+static bool poolsReady;
+
+// Thread the free lists through the arena, on first use since String and
+// new may run in static constructors
+static void pool_init(void)
+{
+	uint8_t *block = (uint8_t *)arena;
+
+	for (int c = 0; c < POOL_CLASSES; c++)
+	{
+		classStart[c] = block;
+		classStats[c].block_size = blockSizes[c];
+		classStats[c].blocks = blockCounts[c];
+
+		pool_block_t **link = &freeList[c];
+		for (int i = 0; i < blockCounts[c]; i++)
+		{
+			*link = (pool_block_t *)block;
+			link = &(*link)->next;
+			block += blockSizes[c];
+		}
+		*link = NULL;
+	}
+	classStart[POOL_CLASSES] = block;
+	poolsReady = true;
+}
+
+// The class a block belongs to, or -1 when it came from the heap
+static int pool_class_of(const void *ptr)
+{
+	const uint8_t *p = (const uint8_t *)ptr;
+
+	if (!poolsReady || p < classStart[0] || p >= classStart[POOL_CLASSES])
+	{
+		return -1;
+	}
+
+	int c = 0;
+	while (p >= classStart[c + 1])
+	{
+		c++;
+	}
+	return c;
+}
+
+/*
+ * Takes a block from the smallest class that fits, or from a larger class
+ * when that one is full, before falling back to the heap.
+ */
+void *pool_malloc(size_t size)
+{
+	if (!poolsReady)
+	{
+		pool_init();
+	}
+	allocCount++;
+
+	int c = 0;
+	while (c < POOL_CLASSES && size > blockSizes[c])
+	{
+		c++;
+	}
+
+	for (int first = c; c < POOL_CLASSES; c++)
+	{
+		pool_block_t *block = freeList[c];
+		if (block)
+		{
+			freeList[c] = block->next;
+			pool_class_stats_t *stats = &classStats[c];
+			stats->allocs++;
+			if (++stats->in_use > stats->peak)
+			{
+				stats->peak = stats->in_use;
+			}
+			return block;
+		}
+		if (c == first)
+		{
+			classStats[c].overflows++;
+		}
+	}
+
+	void *ptr = malloc(size);
+	if (!ptr)
+	{
+		failedAllocs++;
+	}
+	return ptr;
+}
+
+void *pool_calloc(size_t count, size_t size)
+{
+	if (size && count > (size_t)-1 / size)
+	{
+		failedAllocs++;
+		return NULL;
+	}
+
+	void *ptr = pool_malloc(count * size);
+	if (ptr)
+	{
+		memset(ptr, 0, count * size);
+	}
+	return ptr;
+}
+
+/*
+ * A pool block is kept while the new size fits in it, otherwise the data
+ * moves to a new allocation. Heap blocks stay on the heap.
+ */
+void *pool_realloc(void *ptr, size_t size)
+{
+	if (!ptr)
+	{
+		return pool_malloc(size);
+	}
+
+	int c = pool_class_of(ptr);
+	if (c < 0)
+	{
+		void *moved = realloc(ptr, size);
+		allocCount++;
+		if (!moved && size)
+		{
+			failedAllocs++;
+		}
+		return moved;
+	}
+
+	if (size <= blockSizes[c])
+	{
+		return ptr;
+	}
+
+	void *moved = pool_malloc(size);
+	if (moved)
+	{
+		memcpy(moved, ptr, blockSizes[c]);
+		pool_free(ptr);
+	}
+	return moved;
+}
+
+void pool_free(void *ptr)
+{
+	int c = pool_class_of(ptr);
+	if (c < 0)
+	{
+		free(ptr);
+		return;
+	}
+
+	pool_block_t *block = (pool_block_t *)ptr;
+	block->next = freeList[c];
+	freeList[c] = block;
+	classStats[c].in_use--;
+}
+
+size_t pool_block_size(const void *ptr)
+{
+	int c = pool_class_of(ptr);
+	return c < 0 ? 0 : blockSizes[c];
+}
+
+uint32_t pool_alloc_count(void)
+{
+	return allocCount;
+}
+
+void pool_stats(heap_stats_t *stats)
+{
+	if (!poolsReady)
+	{
+		pool_init();
+	}
+
+	stats->allocs = allocCount;
+	stats->failed_allocs = failedAllocs;
+	memcpy(stats->pools, classStats, sizeof(classStats));
+}
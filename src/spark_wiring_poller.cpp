@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_poller.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Wait on several sockets with a single select()
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#include "spark_wiring_poller.h"
+
+#ifdef SPARK_POSIX
+#include <sys/select.h>
+typedef fd_set poll_fd_set;
+#else
+#include "spark_wiring.h"
+typedef _types_fd_set_cc3000 poll_fd_set;
+#endif
+
+Pollable::~Pollable()
+{
+  if (_poller)
+  {
+      _poller->remove(*this);
+  }
+}
+
+SocketPoller::SocketPoller() : _count(0)
+{
+}
+
+bool SocketPoller::add(Pollable &item)
+{
+  if (item._poller)
+  {
+      return item._poller == this;
+  }
+  if (_count == POLLER_MAX_SOCKETS)
+  {
+      return false;
+  }
+  _items[_count++] = &item;
+  item._poller = this;
+  return true;
+}
+
+void SocketPoller::remove(Pollable &item)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+      if (_items[i] == &item)
+      {
+          _items[i] = _items[--_count];
+          item._poller = NULL;
+          return;
+      }
+  }
+}
+
+/*
+ * Wait up to usec for any registered socket to become readable, then let
+ * each readable object receive into its buffer. Returns the number of
+ * objects that received, 0 on timeout or negative on error.
+ */
+int SocketPoller::poll(uint32_t usec)
+{
+  long socks[POLLER_MAX_SOCKETS];
+  uint8_t ready[POLLER_MAX_SOCKETS];
+  Pollable* items[POLLER_MAX_SOCKETS];
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+      long sock = _items[i]->pollSocket();
+      if (sock >= 0)
+      {
+          socks[count] = sock;
+          items[count++] = _items[i];
+      }
+  }
+
+  int rv = socket_poll(socks, count, ready, usec);
+  if (rv <= 0)
+  {
+      return rv;
+  }
+
+  int dispatched = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+      if (ready[i])
+      {
+          items[i]->pollReady();
+          dispatched++;
+      }
+  }
+  return dispatched;
+}
+
+int socket_poll(const long *socks, uint8_t count, uint8_t *ready, uint32_t usec)
+{
+  poll_fd_set readSet;
+  timeval timeout;
+  long maxSock = -1;
+
+  FD_ZERO(&readSet);
+  for (uint8_t i = 0; i < count; i++)
+  {
+      FD_SET(socks[i], &readSet);
+      if (socks[i] > maxSock) maxSock = socks[i];
+  }
+
+  timeout.tv_sec = usec / 1000000;
+  timeout.tv_usec = usec % 1000000;
+
+  int rv = select(maxSock + 1, &readSet, NULL, NULL, &timeout);
+  for (uint8_t i = 0; i < count; i++)
+  {
+      ready[i] = (rv > 0) && FD_ISSET(socks[i], &readSet);
+  }
+  return rv;
+}
@@ -28,8 +28,18 @@
 #include "spark_wiring.h"
 #include "spark_wiring_print.h"
 #include "spark_wiring_string.h"
+#include "spark_wiring_stringview.h"
 #include "spark_wiring_stream.h"
 
+// printf() output is written in pieces of at most this size
+#define PRINTF_BUFFER_SIZE 64
+
+// Most digits printed after the point, and room for a number printed with them
+#define FLOAT_MAX_DIGITS 20
+#define FLOAT_BUFFER_SIZE (1 + 10 + 1 + FLOAT_MAX_DIGITS)
+
+static size_t formatFloat(double number, int digits, char *buf);
+
 // Public Methods //////////////////////////////////////////////////////////////
 
 /* default implementation: may be overridden */
@@ -52,6 +62,11 @@ size_t Print::print(const char str[])
   return write(str);
 }
 
+size_t Print::print(const StringView &s)
+{
+  return write((const uint8_t*)s.data(), s.length());
+}
+
 size_t Print::print(char c)
 {
   return write(c);
@@ -76,13 +91,8 @@ size_t Print::print(long n, int base)
 {
   if (base == 0) {
     return write(n);
-  } else if (base == 10) {
-    if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
-    }
-    return printNumber(n, 10);
+  } else if (base == 10 && n < 0) {
+    return printNumber(0UL - (unsigned long)n, 10, true);
   } else {
     return printNumber(n, base);
   }
@@ -106,9 +116,7 @@ size_t Print::print(double n, int digits)
 
 size_t Print::println(void)
 {
-  size_t n = print('\r');
-  n += print('\n');
-  return n;
+  return write("\r\n");
 }
 
 size_t Print::println(const String &s)
@@ -125,6 +133,13 @@ size_t Print::println(const char c[])
   return n;
 }
 
+size_t Print::println(const StringView &s)
+{
+  size_t n = print(s);
+  n += println();
+  return n;
+}
+
 size_t Print::println(char c)
 {
   size_t n = print(c);
@@ -181,58 +196,236 @@ size_t Print::println(double num, int digits)
    return n;
  }
 
-// Private Methods /////////////////////////////////////////////////////////////
+size_t Print::printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  size_t n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+/*
+ * printf() output collects here and goes to the Print in one write(), or in
+ * one write() per PRINTF_BUFFER_SIZE characters when it is longer.
+ */
+class PrintfBuffer
+{
+  public:
+    PrintfBuffer(Print &out) : out(out), length(0), total(0) {}
+
+    void put(char c) {
+      if (length == sizeof(buffer)) flush();
+      buffer[length++] = c;
+    }
+    void put(const char *str, size_t n) {
+      while (n--) put(*str++);
+    }
+    void pad(char c, int n) {
+      while (n-- > 0) put(c);
+    }
+    size_t flush() {
+      if (length) total += out.write(buffer, length);
+      length = 0;
+      return total;
+    }
 
-size_t Print::printNumber(unsigned long n, uint8_t base) {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
+  private:
+    Print &out;
+    uint8_t buffer[PRINTF_BUFFER_SIZE];
+    size_t length;
+    size_t total;
+};
 
-  *str = '\0';
+size_t Print::vprintf(const char *format, va_list args)
+{
+  PrintfBuffer out(*this);
+  char number[FLOAT_BUFFER_SIZE];
+  char *end = number + sizeof(number);
+
+  for (; *format; format++) {
+    if (*format != '%') {
+      out.put(*format);
+      continue;
+    }
+
+    bool left = false, zero = false, plus = false, isLong = false;
+    int width = 0, precision = -1;
+
+    for (;; format++) {
+      char flag = format[1];
+      if (flag == '-') left = true;
+      else if (flag == '0') zero = true;
+      else if (flag == '+') plus = true;
+      else break;
+    }
+    format++;
+
+    if (*format == '*') {
+      width = va_arg(args, int);
+      if (width < 0) {
+        left = true;
+        width = -width;
+      }
+      format++;
+    } else {
+      while (*format >= '0' && *format <= '9') width = width * 10 + *format++ - '0';
+    }
+
+    if (*format == '.') {
+      format++;
+      precision = 0;
+      if (*format == '*') {
+        precision = va_arg(args, int);
+        format++;
+      } else {
+        while (*format >= '0' && *format <= '9') precision = precision * 10 + *format++ - '0';
+      }
+    }
+
+    while (*format == 'l' || *format == 'h') {
+      if (*format == 'l') isLong = true;
+      format++;
+    }
+
+    const char *str = end;
+    size_t n = 0;
+    char sign = 0;
+
+    switch (*format) {
+      case 'd':
+      case 'i': {
+        long value = isLong ? va_arg(args, long) : va_arg(args, int);
+        if (value < 0) sign = '-';
+        else if (plus) sign = '+';
+        str = format_digits(value < 0 ? 0UL - (unsigned long)value : value, end, 10);
+        n = end - str;
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o': {
+        unsigned long value = isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+        uint8_t base = *format == 'u' ? 10 : *format == 'o' ? 8 : 16;
+        str = format_digits(value, end, base, *format == 'x' ? 'a' : 'A');
+        n = end - str;
+        break;
+      }
+      case 'c':
+        number[0] = (char)va_arg(args, int);
+        str = number;
+        n = 1;
+        zero = false;
+        break;
+      case 's':
+        str = va_arg(args, const char *);
+        if (str == NULL) str = "(null)";
+        while ((precision < 0 || (int)n < precision) && str[n]) n++;
+        zero = false;
+        break;
+      case 'f':
+        n = formatFloat(va_arg(args, double), precision < 0 ? 6 : precision, number);
+        str = number;
+        if (*str == '-') {
+          sign = *str++;
+          n--;
+        } else if (plus) {
+          sign = '+';
+        }
+        break;
+      case '%':
+        out.put('%');
+        continue;
+      case '\0':
+        return out.flush();
+      default:
+        // not a conversion, print it as it is
+        out.put('%');
+        out.put(*format);
+        continue;
+    }
+
+    int padding = width - (int)n - (sign ? 1 : 0);
+    if (!left && !zero) out.pad(' ', padding);
+    if (sign) out.put(sign);
+    if (!left && zero) out.pad('0', padding);
+    out.put(str, n);
+    if (left) out.pad(' ', padding);
+  }
+
+  return out.flush();
+}
+
+// Private Methods /////////////////////////////////////////////////////////////
+
+size_t Print::printNumber(unsigned long n, uint8_t base, bool negative) {
+  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus a sign.
+  char *end = &buf[sizeof(buf)];
 
   // prevent crash if called with base == 1
   if (base < 2) base = 10;
 
-  do {
-    unsigned long m = n;
-    n /= base;
-    char c = m - base * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
+  char *str = format_digits(n, end, base);
+  if (negative) *--str = '-';
 
-  return write(str);
+  return write((const uint8_t *)str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits) 
 { 
-  size_t n = 0;
-  
-  if (isnan(number)) return print("nan");
-  if (isinf(number)) return print("inf");
-  if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
-  if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
-  
+  char buf[FLOAT_BUFFER_SIZE];
+  return write((const uint8_t *)buf, formatFloat(number, digits, buf));
+}
+
+/*
+ * Writes number with the given digits after the point into buf, which holds
+ * FLOAT_BUFFER_SIZE characters, and returns the length. There is no
+ * terminator. Returns "nan", "inf" or "ovf" for numbers it cannot show.
+ */
+static size_t formatFloat(double number, int digits, char *buf)
+{
+  char *str = buf;
+
+  const char *special = NULL;
+  if (isnan(number)) special = "nan";
+  else if (isinf(number)) special = number < 0.0 ? "-inf" : "inf";
+  else if (number > 4294967040.0) special = "ovf";  // constant determined empirically
+  else if (number <-4294967040.0) special = "ovf";  // constant determined empirically
+  if (special) {
+    size_t n = strlen(special);
+    memcpy(buf, special, n);
+    return n;
+  }
+
+  if (digits > FLOAT_MAX_DIGITS) digits = FLOAT_MAX_DIGITS;
+
   // Handle negative numbers
   if (number < 0.0)
   {
-     n += print('-');
+     *str++ = '-';
      number = -number;
   }
 
   // Round correctly so that print(1.999, 2) prints as "2.00"
   double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
+  for (int i=0; i<digits; ++i)
     rounding /= 10.0;
   
   number += rounding;
 
-  // Extract the integer part of the number and print it
+  // Extract the integer part of the number
   unsigned long int_part = (unsigned long)number;
   double remainder = number - (double)int_part;
-  n += print(int_part);
+  char intBuf[8 * sizeof(long)];
+  char *intEnd = intBuf + sizeof(intBuf);
+  char *intStr = format_digits(int_part, intEnd, 10);
+  memcpy(str, intStr, intEnd - intStr);
+  str += intEnd - intStr;
 
-  // Print the decimal point, but only if there are digits beyond
+  // The decimal point, but only if there are digits beyond
   if (digits > 0) {
-    n += print("."); 
+    *str++ = '.';
   }
 
   // Extract digits from the remainder one at a time
@@ -240,9 +433,33 @@ size_t Print::printFloat(double number, uint8_t digits)
   {
     remainder *= 10.0;
     int toPrint = int(remainder);
-    n += print(toPrint);
+    *str++ = '0' + toPrint;
     remainder -= toPrint; 
   } 
   
+  return str - buf;
+}
+
+/*
+ * BufferPrint
+ */
+
+BufferPrint::BufferPrint(char *buffer, size_t size) : buffer(buffer), size(size), length(0)
+{
+  if (size) buffer[0] = '\0';
+}
+
+size_t BufferPrint::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t BufferPrint::write(const uint8_t *data, size_t n)
+{
+  if (!size) return 0;
+  if (n > size - 1 - length) n = size - 1 - length;
+  memcpy(buffer + length, data, n);
+  length += n;
+  buffer[length] = '\0';
   return n;
 }
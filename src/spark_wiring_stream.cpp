@@ -53,26 +53,58 @@ int Stream::timedPeek()
   return -1;     // -1 indicates timeout
 }
 
+// waits up to the timeout for received data, see peekBuffer()
+size_t Stream::timedPeekBuffer(const uint8_t *&data)
+{
+  size_t n;
+  _startMillis = millis();
+  do {
+    n = peekBuffer(data);
+    if (n > 0) return n;
+  } while(millis() - _startMillis < _timeout);
+  return 0;     // 0 indicates timeout
+}
+
 // returns peek of the next digit in the stream or -1 if timeout
 // discards non-numeric characters
 int Stream::peekNextDigit()
 {
-  int c = -1;
-  while (1) {
-    c = timedPeek();
-    // timeout
-    if ((c < 0) || (c == '-') || (c >= '0' && c <= '9'))
-    {
-        break;
+  const uint8_t *data;
+  size_t n;
+  while ((n = timedPeekBuffer(data)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      int c = data[i];
+      if ((c == '-') || (c >= '0' && c <= '9')) {
+        consume(i);  // discard non-numeric
+        return c;
+      }
     }
-    read();  // discard non-numeric
+    consume(n);
   }
-  return c;
+  return -1;  // timeout
 }
 
 // Public Methods
 //////////////////////////////////////////////////////////////
 
+/* default implementation: may be overridden */
+size_t Stream::peekBuffer(const uint8_t *&data)
+{
+  int c = peek();
+  if (c < 0) return 0;
+  _peeked = c;
+  data = &_peeked;
+  return 1;
+}
+
+/* default implementation: may be overridden */
+void Stream::consume(size_t length)
+{
+  while (length--) {
+    read();
+  }
+}
+
 void Stream::setTimeout(system_tick_t timeout)  // sets the maximum number of milliseconds to wait
 {
   _timeout = timeout;
@@ -81,7 +113,7 @@ void Stream::setTimeout(system_tick_t timeout)  // sets the maximum number of mi
  // find returns true if the target string is found
 bool  Stream::find(char *target)
 {
-  return findUntil(target, NULL);
+  return findUntil(target, strlen(target), NULL, 0);
 }
 
 // reads data from the stream until the target string of given length is found
@@ -104,33 +136,43 @@ bool Stream::findUntil(char *target, size_t targetLen, char *terminator, size_t
 {
   size_t index = 0;  // maximum target string length is 64k bytes!
   size_t termIndex = 0;
-  int c;
+  const uint8_t *data;
+  size_t n;
   
   if( *target == 0)
     return true;   // return true if target is a null string
-  while( (c = timedRead()) > 0){
-    
-    if(c != target[index])
-      index = 0; // reset index if any char does not match
-    
-    if( c == target[index]){
-      //////Serial.print("found "); Serial.write(c); Serial.print("index now"); Serial.println(index+1);
-      if(++index >= targetLen){ // return true if all chars in the target match
-        return true;
+  while( (n = timedPeekBuffer(data)) > 0){
+    for (size_t i = 0; i < n; i++) {
+      char c = data[i];
+      if (c == 0) {
+        consume(i + 1);
+        return false;
       }
+
+      if(c != target[index])
+        index = 0; // reset index if any char does not match
+
+      if( c == target[index]){
+        if(++index >= targetLen){ // return true if all chars in the target match
+          consume(i + 1);
+          return true;
+        }
+      }
+
+      if(termLen > 0 && c == terminator[termIndex]){
+        if(++termIndex >= termLen) {
+          consume(i + 1);
+          return false;       // return false if terminate string found before target string
+        }
+      }
+      else
+        termIndex = 0;
     }
-    
-    if(termLen > 0 && c == terminator[termIndex]){
-      if(++termIndex >= termLen)
-        return false;       // return false if terminate string found before target string
-    }
-    else
-      termIndex = 0;
+    consume(n);
   }
   return false;
 }
 
-
 // returns the first valid (long) integer value from the current position.
 // initial characters that are not digits (or the minus sign) are skipped
 // function is terminated by the first character that is not a digit.
@@ -144,33 +186,42 @@ long Stream::parseInt()
 long Stream::parseInt(char skipChar)
 {
   bool isNegative = false;
+  bool first = true;
   long value = 0;
-  int c;
+  const uint8_t *data;
+  size_t n, i;
 
-  c = peekNextDigit();
   // ignore non numeric leading characters
-  if(c < 0)
+  if(peekNextDigit() < 0)
     return 0; // zero returned if timeout
 
   do{
-    if(c == skipChar) {
-      // ignore this charactor
-    } else if(c == '-') {
-      isNegative = true;
-    } else if(c >= '0' && c <= '9') {        // is c a digit?
-      value = value * 10 + c - '0';
+    n = timedPeekBuffer(data);
+    for (i = 0; i < n; i++) {
+      int c = data[i];
+      // the first character is the '-' or digit found above, the number
+      // then runs on while there are digits
+      if(!first && !((c >= '0' && c <= '9') || c == skipChar))
+        break;
+      first = false;
+
+      if(c == skipChar) {
+        // ignore this charactor
+      } else if(c == '-') {
+        isNegative = true;
+      } else if(c >= '0' && c <= '9') {        // is c a digit?
+        value = value * 10 + c - '0';
+      }
     }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+    consume(i);  // consume the characters we used
   }
-  while( (c >= '0' && c <= '9') || c == skipChar );
+  while( n > 0 && i == n );
 
   if(isNegative)
     value = -value;
   return value;
 }
 
-
 // as parseInt but returns a floating point value
 float Stream::parseFloat()
 {
@@ -182,31 +233,39 @@ float Stream::parseFloat()
 float Stream::parseFloat(char skipChar){
   bool isNegative = false;
   bool isFraction = false;
+  bool first = true;
   long value = 0;
-  char c;
   float fraction = 1.0;
+  const uint8_t *data;
+  size_t n, i;
 
-  c = peekNextDigit();
-    // ignore non numeric leading characters
-  if(c < 0)
+  // ignore non numeric leading characters
+  if(peekNextDigit() < 0)
     return 0; // zero returned if timeout
 
   do{
-    if(c == skipChar) {
-      // ignore
-    } else if(c == '-') {
-      isNegative = true;
-    } else if (c == '.') {
-      isFraction = true;
-    } else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1;
+    n = timedPeekBuffer(data);
+    for (i = 0; i < n; i++) {
+      char c = data[i];
+      if(!first && !((c >= '0' && c <= '9') || c == '.' || c == skipChar))
+        break;
+      first = false;
+
+      if(c == skipChar) {
+        // ignore
+      } else if(c == '-') {
+        isNegative = true;
+      } else if (c == '.') {
+        isFraction = true;
+      } else if(c >= '0' && c <= '9')  {      // is c a digit?
+        value = value * 10 + c - '0';
+        if(isFraction)
+           fraction *= 0.1;
+      }
     }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+    consume(i);  // consume the characters we used
   }
-  while( (c >= '0' && c <= '9')  || c == '.' || c == skipChar );
+  while( n > 0 && i == n );
 
   if(isNegative)
     value = -value;
@@ -224,11 +283,14 @@ float Stream::parseFloat(char skipChar){
 size_t Stream::readBytes(char *buffer, size_t length)
 {
   size_t count = 0;
+  const uint8_t *data;
   while (count < length) {
-    int c = timedRead();
-    if (c < 0) break;
-    *buffer++ = (char)c;
-    count++;
+    size_t n = timedPeekBuffer(data);
+    if (n == 0) break;
+    if (n > length - count) n = length - count;
+    memcpy(buffer + count, data, n);
+    consume(n);
+    count += n;
   }
   return count;
 }
@@ -242,11 +304,21 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
 {
   if (length < 1) return 0;
   size_t index = 0;
+  const uint8_t *data;
   while (index < length) {
-    int c = timedRead();
-    if (c < 0 || c == terminator) break;
-    *buffer++ = (char)c;
-    index++;
+    size_t n = timedPeekBuffer(data);
+    if (n == 0) break;
+    if (n > length - index) n = length - index;
+    const uint8_t *found = (const uint8_t *)memchr(data, terminator, n);
+    if (found) {
+      n = found - data;
+      memcpy(buffer + index, data, n);
+      consume(n + 1);  // the terminator is consumed but not stored
+      return index + n;
+    }
+    memcpy(buffer + index, data, n);
+    consume(n);
+    index += n;
   }
   return index; // return number of characters, not including null terminator
 }
@@ -254,11 +326,12 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
 String Stream::readString()
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0)
+  const uint8_t *data;
+  size_t n;
+  while ((n = timedPeekBuffer(data)) > 0)
   {
-    ret += (char)c;
-    c = timedRead();
+    ret.concat(StringView((const char *)data, n));
+    consume(n);
   }
   return ret;
 }
@@ -266,12 +339,25 @@ String Stream::readString()
 String Stream::readStringUntil(char terminator)
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0 && c != terminator)
+  const uint8_t *data;
+  size_t n;
+  while ((n = timedPeekBuffer(data)) > 0)
   {
-    ret += (char)c;
-    c = timedRead();
+    const uint8_t *found = (const uint8_t *)memchr(data, terminator, n);
+    size_t length = found ? (size_t)(found - data) : n;
+    ret.concat(StringView((const char *)data, length));
+    if (found)
+    {
+      consume(length + 1);
+      break;
+    }
+    consume(n);
   }
   return ret;
 }
 
+StringView Stream::readStringUntil(char terminator, char *buffer, size_t length)
+{
+  return StringView(buffer, readBytesUntil(terminator, buffer, length));
+}
+
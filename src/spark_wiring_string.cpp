@@ -27,6 +27,8 @@
  */
 
 #include "spark_wiring_string.h"
+#include "spark_wiring_stringview.h"
+#include "pool_alloc.h"
 #include <stdio.h>
 #include <limits.h>
 
@@ -43,56 +45,73 @@ char *dtostrf (double val, signed char width, unsigned char prec, char *sout) {
   return sout;
 }
 
-//utility function used by ultoa()
-void str_reverse(char* buffer){
-	char *i, *j;
-	char c;
-	i=buffer;
-	j=buffer + strlen(buffer)-1;
-	while(i<j){
-		c = *i;
-		*i = *j;
-		*j = c;
-		++i;
-		--j;
+// "00" to "99", so decimal conversion divides once for every two digits
+static const char digitPairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// writes the digits of value so that they end just before end, and returns
+// the first one. digits above 9 are letters counting up from letter. radix
+// must be at least 2
+char *format_digits(unsigned long value, char *end, unsigned char radix, char letter)
+{
+	char *ptr = end;
+	if (radix == 10) {
+		while (value >= 100) {
+			unsigned int pair = (value % 100) * 2;
+			value /= 100;
+			*--ptr = digitPairs[pair + 1];
+			*--ptr = digitPairs[pair];
+		}
+		if (value >= 10) {
+			*--ptr = digitPairs[value * 2 + 1];
+			*--ptr = digitPairs[value * 2];
+		} else {
+			*--ptr = '0' + value;
+		}
+	} else if ((radix & (radix - 1)) == 0) {
+		// powers of two shift instead of dividing
+		unsigned char shift = 0;
+		while ((1U << shift) < radix) shift++;
+		do {
+			unsigned char digit = value & (radix - 1);
+			*--ptr = digit < 10 ? '0' + digit : letter + digit - 10;
+			value >>= shift;
+		} while (value);
+	} else {
+		do {
+			unsigned char digit = value % radix;
+			*--ptr = digit < 10 ? '0' + digit : letter + digit - 10;
+			value /= radix;
+		} while (value);
 	}
+	return ptr;
 }
 
 //convert long to string
 char *ltoa(long N, char *str, int base)
 {
-      register int i = 2;
-      long uarg;
-      char *tail, *head = str, buf[BUFSIZE];
-
-      if (36 < base || 2 > base)
-            base = 10;                    /* can only use 0-9, A-Z        */
-      tail = &buf[BUFSIZE - 1];           /* last character position      */
-      *tail-- = '\0';
+	char buf[BUFSIZE];
+	char *tail = &buf[BUFSIZE];
+	char *head = str;
+	unsigned long uarg = N;
 
-      if (10 == base && N < 0L)
-      {
-            *head++ = '-';
-            uarg    = -N;
-      }
-      else  uarg = N;
+	if (36 < base || 2 > base)
+		base = 10;                    /* can only use 0-9, A-Z        */
 
-      if (uarg)
-      {
-            for (i = 1; uarg; ++i)
-            {
-                  register ldiv_t r;
-
-                  r       = ldiv(uarg, base);
-                  *tail-- = (char)(r.rem + ((9L < r.rem) ?
-                                  ('A' - 10L) : '0'));
-                  uarg    = r.quot;
-            }
-      }
-      else  *tail-- = '0';
+	if (10 == base && N < 0L)
+	{
+		*head++ = '-';
+		uarg = 0UL - uarg;
+	}
 
-      memcpy(head, ++tail, i);
-      return str;
+	char *digits = format_digits(uarg, tail, base, 'A');
+	memcpy(head, digits, tail - digits);
+	head[tail - digits] = '\0';
+	return str;
 }
 
 //convert unsigned long to string
@@ -100,30 +119,11 @@ char* ultoa(unsigned long a, char* buffer, unsigned char radix){
 	if(radix<2 || radix>36){
 		return NULL;
 	}
-	char* ptr=buffer;
-	div_t result;
-	if(a==0){
-		ptr[0] = '0';
-		ptr[1] = '\0';
-		return buffer;
-	}
-	while(a){
-		/* toolchain bug??
-		result = div(a, radix);
-		*/
-		result.quot = a/radix;
-		result.rem = a%radix;
-		*ptr = result.rem;
-		if(result.rem<10){
-			*ptr += '0';
-		}else{
-			*ptr += 'a'-10;
-		}
-		++ptr;
-		a = result.quot;
-	}
-	*ptr = '\0';
-	str_reverse(buffer);
+	char buf[BUFSIZE];
+	char *tail = &buf[BUFSIZE];
+	char *digits = format_digits(a, tail, radix, 'a');
+	memcpy(buffer, digits, tail - digits);
+	buffer[tail - digits] = '\0';
 	return buffer;
 }
 
@@ -135,15 +135,14 @@ char* utoa(unsigned a, char* buffer, unsigned char radix){
 char* itoa(int a, char* buffer, unsigned char radix){
 	if(a<0){
 		*buffer = '-';
-		unsigned v = a==INT_MIN ? ((unsigned)INT_MAX+1) : -a;        
-		ultoa((unsigned)v, buffer + 1, radix);
+		unsigned v = 0U - (unsigned)a;
+		ultoa(v, buffer + 1, radix);
 	}else{
 		ultoa(a, buffer, radix);
 	}
 	return buffer;
 }
 
-
 // void itoa(int value, char *sp, int radix)
 // {
 //     char tmp[16];// be careful with the length of the buffer
@@ -186,6 +185,12 @@ String::String(const char *cstr)
 	if (cstr) copy(cstr, strlen(cstr));
 }
 
+String::String(const StringView &view)
+{
+	init();
+	copy(view.data(), view.length());
+}
+
 String::String(const String &value)
 {
 	init();
@@ -269,7 +274,7 @@ String::String(double value, int decimalPlaces)
 }
 String::~String()
 {
-	free(buffer);
+	if (onHeap()) pool_free(buffer);
 }
 
 /*********************************************/
@@ -286,7 +291,7 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	if (onHeap()) pool_free(buffer);
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -303,10 +308,26 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	if (!onHeap() && maxStrLen <= STRING_INLINE_SIZE) {
+		if (!buffer) {
+			buffer = inlineBuffer;
+			buffer[0] = 0;
+		}
+		capacity = STRING_INLINE_SIZE;
+		return 1;
+	}
+	char *newbuffer;
+	if (onHeap()) {
+		newbuffer = (char *)pool_realloc(buffer, maxStrLen + 1);
+	} else {
+		newbuffer = (char *)pool_malloc(maxStrLen + 1);
+		if (newbuffer && buffer) memcpy(newbuffer, buffer, len + 1);
+	}
 	if (newbuffer) {
 		buffer = newbuffer;
-		capacity = maxStrLen;
+		// a pool block may have room to spare
+		unsigned int block = pool_block_size(newbuffer);
+		capacity = block > maxStrLen + 1 ? block - 1 : maxStrLen;
 		return 1;
 	}
 	return 0;
@@ -323,23 +344,28 @@ String & String::copy(const char *cstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	strcpy(buffer, cstr);
+	memmove(buffer, cstr, length);
+	buffer[len] = 0;
 	return *this;
 }
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs)
 {
-	if (buffer) {
-		if (capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
-			len = rhs.len;
-			rhs.len = 0;
-			return;
-		} else {
-			free(buffer);
-		}
+	if (buffer && rhs.buffer && capacity >= rhs.len) {
+		memcpy(buffer, rhs.buffer, rhs.len + 1);
+		len = rhs.len;
+		rhs.len = 0;
+		return;
+	}
+	if (!rhs.onHeap()) {
+		// an inline buffer can't be taken over, copy it
+		if (rhs.buffer) copy(rhs.buffer, rhs.len);
+		else invalidate();
+		rhs.len = 0;
+		return;
 	}
+	if (onHeap()) pool_free(buffer);
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
@@ -359,6 +385,12 @@ String & String::operator = (const String &rhs)
 	return *this;
 }
 
+String & String::operator = (const StringView &view)
+{
+	copy(view.data(), view.length());
+	return *this;
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 String & String::operator = (String &&rval)
 {
@@ -395,9 +427,17 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	if (newlen > capacity || !buffer) {
+		// appending part of this string, which may move
+		unsigned int self = (buffer && cstr >= buffer && cstr <= buffer + len) ? cstr - buffer + 1 : 0;
+		// grow by half again, so appending a char at a time reallocates
+		// O(log n) times; fall back to an exact fit when memory is short
+		if (!reserve(newlen + (newlen >> 1)) && !reserve(newlen)) return 0;
+		if (self) cstr = buffer + self - 1;
+	}
+	memmove(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -407,6 +447,11 @@ unsigned char String::concat(const char *cstr)
 	return concat(cstr, strlen(cstr));
 }
 
+unsigned char String::concat(const StringView &view)
+{
+	return concat(view.data(), view.length());
+}
+
 unsigned char String::concat(char c)
 {
 	char buf[2];
@@ -810,7 +855,8 @@ void String::remove(unsigned int index, unsigned int count){
 	if (index + count > len) { count = len - index; }
 	char *writeTo = buffer + index;
 	len = len - count;
-	strncpy(writeTo, buffer + index + count,len - index);
+	// the tail moves down over itself, which strncpy does not allow
+	memmove(writeTo, buffer + index + count, len - index);
 	buffer[len] = 0;
 }
 
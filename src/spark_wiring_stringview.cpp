@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * @file    spark_wiring_stringview.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Non-owning view of characters, for parsing without the heap
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+#include <ctype.h>
+
+#include "spark_wiring_stringview.h"
+#include "spark_wiring_string.h"
+
+// An invalid String is viewed as empty
+StringView::StringView(const String &str)
+	: _data(str.c_str() ? str.c_str() : ""), _length(str.length())
+{
+}
+
+/*********************************************/
+/*  Comparison                               */
+/*********************************************/
+
+unsigned char StringView::equals(const StringView &s) const
+{
+	return _length == s._length && memcmp(_data, s._data, _length) == 0;
+}
+
+unsigned char StringView::equalsIgnoreCase(const StringView &s) const
+{
+	if (_length != s._length) return 0;
+	for (unsigned int i = 0; i < _length; i++) {
+		if (tolower((unsigned char)_data[i]) != tolower((unsigned char)s._data[i])) return 0;
+	}
+	return 1;
+}
+
+unsigned char StringView::startsWith(const StringView &prefix) const
+{
+	return _length >= prefix._length && memcmp(_data, prefix._data, prefix._length) == 0;
+}
+
+unsigned char StringView::startsWithIgnoreCase(const StringView &prefix) const
+{
+	if (_length < prefix._length) return 0;
+	return StringView(_data, prefix._length).equalsIgnoreCase(prefix);
+}
+
+unsigned char StringView::endsWith(const StringView &suffix) const
+{
+	if (_length < suffix._length) return 0;
+	return memcmp(_data + _length - suffix._length, suffix._data, suffix._length) == 0;
+}
+
+/*********************************************/
+/*  Search                                   */
+/*********************************************/
+
+int StringView::indexOf(char ch, unsigned int fromIndex) const
+{
+	if (fromIndex >= _length) return -1;
+	const char *found = (const char *)memchr(_data + fromIndex, ch, _length - fromIndex);
+	if (found == NULL) return -1;
+	return found - _data;
+}
+
+StringView StringView::substring(unsigned int beginIndex) const
+{
+	return substring(beginIndex, _length);
+}
+
+StringView StringView::substring(unsigned int left, unsigned int right) const
+{
+	if (left > right) {
+		unsigned int temp = right;
+		right = left;
+		left = temp;
+	}
+	if (right > _length) right = _length;
+	if (left > right) left = right;
+	return StringView(_data + left, right - left);
+}
+
+/*********************************************/
+/*  Modification                             */
+/*********************************************/
+
+StringView StringView::trim(void) const
+{
+	unsigned int begin = 0;
+	unsigned int end = _length;
+	while (begin < end && isspace((unsigned char)_data[begin])) begin++;
+	while (end > begin && isspace((unsigned char)_data[end - 1])) end--;
+	return StringView(_data + begin, end - begin);
+}
+
+StringView StringView::split(char delimiter)
+{
+	int index = indexOf(delimiter);
+	StringView token;
+	if (index < 0) {
+		token = *this;
+		_data += _length;
+		_length = 0;
+	} else {
+		token = StringView(_data, index);
+		_data += index + 1;
+		_length -= index + 1;
+	}
+	return token;
+}
+
+void StringView::toCharArray(char *buf, unsigned int bufsize) const
+{
+	if (!bufsize || !buf) return;
+	unsigned int n = bufsize - 1;
+	if (n > _length) n = _length;
+	memcpy(buf, _data, n);
+	buf[n] = 0;
+}
+
+/*********************************************/
+/*  Parsing / Conversion                     */
+/*********************************************/
+
+// Like atol(), stopping at the end of the view rather than at a '\0'
+long StringView::toInt(void) const
+{
+	unsigned int i = 0;
+	while (i < _length && isspace((unsigned char)_data[i])) i++;
+
+	bool negative = false;
+	if (i < _length && (_data[i] == '-' || _data[i] == '+')) {
+		negative = _data[i] == '-';
+		i++;
+	}
+
+	unsigned long value = 0;
+	while (i < _length && _data[i] >= '0' && _data[i] <= '9') {
+		value = value * 10 + (_data[i] - '0');
+		i++;
+	}
+	return negative ? -(long)value : (long)value;
+}
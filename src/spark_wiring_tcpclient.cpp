@@ -28,22 +28,30 @@
 #include "spark_wiring_tcpclient.h"
 
 uint16_t TCPClient::_srcport = 1024;
+TCPClient* TCPClient::_writers[MAX_SOCK_NUM];
+uint8_t TCPClient::_closeCount[MAX_SOCK_NUM];
+system_tick_t TCPClient::_lastReceive[MAX_SOCK_NUM];
 
 static bool inline isOpen(long sd)
 {
    return sd != MAX_SOCK_NUM;
 }
 
-TCPClient::TCPClient() : _sock(MAX_SOCK_NUM)
+TCPClient::TCPClient() : _sock(MAX_SOCK_NUM), _txCount(0), _txBuffered(false), _pollTimeout(TCPCLIENT_POLL_TIMEOUT), _nonBlocking(false)
 {
   flush();
 }
 
-TCPClient::TCPClient(uint8_t sock) : _sock(sock) 
+TCPClient::TCPClient(uint8_t sock) : _sock(sock), _txCount(0), _txBuffered(false), _pollTimeout(TCPCLIENT_POLL_TIMEOUT), _nonBlocking(false)
 {
   flush();
 }
 
+TCPClient::~TCPClient()
+{
+  sendPending();
+}
+
 int TCPClient::connect(const char* host, uint16_t port) 
 {
       int rv = 0;
@@ -68,10 +76,19 @@ int TCPClient::connect(IPAddress ip, uint16_t port)
         if(WiFi.ready())
         {
           sockaddr tSocketAddr;
-          _sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-          DEBUG("socket=%d",_sock);
+          long sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+          DEBUG("socket=%d",sock);
 
-          if (_sock >= 0)
+          // The per-socket tables only reach MAX_SOCK_NUM - 1
+          if (sock >= MAX_SOCK_NUM)
+          {
+              closesocket(sock);
+              sock = -1;
+          }
+          _sock = (sock >= 0) ? sock : MAX_SOCK_NUM;
+          _nonBlocking = false;
+
+          if (isOpen(_sock))
           {
             flush();
 
@@ -108,73 +125,240 @@ size_t TCPClient::write(uint8_t b)
 
 size_t TCPClient::write(const uint8_t *buffer, size_t size)
 {
-        return status() ? send(_sock, buffer, size, 0) : -1;
+        if (!_txBuffered || !status())
+        {
+          return status() ? send(_sock, buffer, size, 0) : -1;
+        }
+
+        if (_txCount + size > arraySize(_txBuffer))
+        {
+          sendPending();
+        }
+        if (size >= arraySize(_txBuffer))
+        {
+          return send(_sock, buffer, size, 0);  // Too big to combine
+        }
+
+        memcpy(&_txBuffer[_txCount], buffer, size);
+        _txCount += size;
+        _writers[_sock] = this;
+        return size;
+}
+
+/*
+ * Hold small writes and send them together, in one CC3000 transaction and
+ * TCP segment. Held data goes out when the buffer fills, on flush() or
+ * stop(), and after each run of the application loop (see flushAll()).
+ */
+void TCPClient::setWriteBuffering(bool enable)
+{
+  if (!enable)
+  {
+      sendPending();
+  }
+  _txBuffered = enable;
+}
+
+void TCPClient::sendPending()
+{
+  if (!isOpen(_sock))
+  {
+      _txCount = 0;
+      return;
+  }
+
+  if (_txCount && status())
+  {
+      send(_sock, _txBuffer, _txCount, 0);
+  }
+  _txCount = 0;
+
+  if (_writers[_sock] == this)
+  {
+      _writers[_sock] = NULL;
+  }
+}
+
+// Send what every client still holds, called after each run of loop()
+void TCPClient::flushAll()
+{
+  for (int sock = 0; sock < MAX_SOCK_NUM; sock++)
+  {
+      if (_writers[sock])
+      {
+          _writers[sock]->sendPending();
+      }
+  }
 }
 
 int TCPClient::bufferCount()
 {
-  return _total - _offset;
+  return _total;
 }
 
-int TCPClient::available() 
+// Copy up to size bytes out of the ring
+int TCPClient::bufferRead(uint8_t *buffer, size_t size)
 {
-    int avail = 0;
+  size_t count = (size > (size_t) _total) ? _total : size;
+  size_t first = arraySize(_buffer) - _offset;
+  if (first > count) first = count;
+
+  memcpy(buffer, &_buffer[_offset], first);
+  memcpy(buffer + first, _buffer, count - first);
+  _offset = (_offset + count) & (arraySize(_buffer) - 1);
+  _total -= count;
+  return count;
+}
+
+// Wait up to the poll timeout for data, true if recv() will not block
+bool TCPClient::poll()
+{
+  if (!WiFi.ready() || !isOpen(_sock))
+  {
+      return false;
+  }
+
+  // A SocketPoller does the waiting for registered clients
+  bool wait = (_pollTimeout != 0) && !_poller;
+
+  if (!wait && !_nonBlocking)
+  {
+      long optval = SOCK_ON;
+      _nonBlocking = (setsockopt(_sock, SOL_SOCKET, SOCKOPT_RECV_NONBLOCK, &optval, sizeof(optval)) >= 0);
+  }
+
+  if (!wait && _nonBlocking)
+  {
+      // Non-blocking recv returns at once when nothing is queued
+      return true;
+  }
+
+  _types_fd_set_cc3000 readSet;
+  timeval timeout;
 
-    // At EOB => Flush it
-    if (_total && (_offset == _total))
+  FD_ZERO(&readSet);
+  FD_SET(_sock, &readSet);
+
+  timeout.tv_sec = wait ? _pollTimeout / 1000000 : 0;
+  timeout.tv_usec = wait ? _pollTimeout % 1000000 : 0;  // 0 if the mode could not be set, raised to 5000 by the CC3000
+
+  return (select(_sock + 1, &readSet, NULL, NULL, &timeout) > 0) && FD_ISSET(_sock, &readSet);
+}
+
+int TCPClient::receive(uint8_t *buffer, size_t size)
+{
+    int ret = recv(_sock, buffer, size, 0);
+    DEBUG("recv(=%d)",ret);
+    if (ret > 0)
     {
-      flush();
+        _lastReceive[_sock] = millis();
     }
+    return ret;
+}
 
-    if(WiFi.ready() && isOpen(_sock))
+// Receive into the free span up to the end of the ring, in one transaction
+void TCPClient::fill()
+{
+    uint16_t in = (_offset + _total) & (arraySize(_buffer) - 1);
+    uint16_t room = (in < _offset) ? _offset - in : arraySize(_buffer) - in;
+    if (_total == 0)
     {
-        // Have room
-        if ( _total < arraySize(_buffer))
-        {
-          _types_fd_set_cc3000 readSet;
-          timeval timeout;
+        _offset = in = 0;
+        room = arraySize(_buffer);
+    }
+
+    int ret = receive(_buffer + in, room);
+    if (ret > 0)
+    {
+        _total += ret;
+    }
+}
 
-          FD_ZERO(&readSet);
-          FD_SET(_sock, &readSet);
+int TCPClient::available() 
+{
+    // Have room
+    if (_total < arraySize(_buffer) && poll())
+    {
+        fill();
+    }
+    return bufferCount();
+}
 
-          timeout.tv_sec = 0;
-          timeout.tv_usec = 5000;
+long TCPClient::pollSocket()
+{
+  return (WiFi.ready() && isOpen(_sock) && _total < arraySize(_buffer)) ? _sock : -1;
+}
 
-          if (select(_sock + 1, &readSet, NULL, NULL, &timeout) > 0)
-          {
-              if (FD_ISSET(_sock, &readSet))
-              {
-                  int ret = recv(_sock, _buffer + _total , arraySize(_buffer)-_total, 0);
-                  DEBUG("recv(=%d)",ret);
-                  if (ret > 0)
-                  {
-                      if (_total == 0) _offset = 0;
-                      _total += ret;
-                  }
-              }
-          } // Select
-          } // Have Space
-    } // WiFi.ready() && isOpen(_sock)
-    avail = bufferCount();
-    return avail;
+void TCPClient::pollReady()
+{
+  fill();
+}
+/*
+ * Time available() waits for data when the buffer is empty. The CC3000 raises
+ * select() timeouts below 5000us to 5000us, so 0 instead puts the socket in
+ * non-blocking receive mode and available() polls without waiting at all.
+ */
+void TCPClient::setPollTimeout(uint32_t usec)
+{
+  _pollTimeout = usec;
 }
 
 int TCPClient::read() 
 {
-
-  return (bufferCount() || available()) ? _buffer[_offset++] : -1;
+  if (bufferCount() || available())
+  {
+      int c = _buffer[_offset];
+      _offset = (_offset + 1) & (arraySize(_buffer) - 1);
+      _total--;
+      return c;
+  }
+  return -1;
 }
 
+/*
+ * Read what is available, up to size bytes. Buffered bytes are copied out;
+ * with nothing buffered the data is received straight into buffer, so a
+ * large read costs one CC3000 transaction rather than one per 128 bytes.
+ */
 int TCPClient::read(uint8_t *buffer, size_t size)
 {
-        int read = -1;
-        if (bufferCount() || available())
+        if (bufferCount())
         {
-          read = (size > (size_t) bufferCount()) ? bufferCount() : size;
-          memcpy(buffer, &_buffer[_offset], read);
-          _offset += read;
+          return bufferRead(buffer, size);
+        }
+        if (size && poll())
+        {
+          int ret = receive(buffer, size);
+          if (ret > 0)
+          {
+            return ret;
+          }
         }
-        return read;
+        return -1;
+}
+
+/*
+ * Read exactly size bytes. Gives up when the connection closes or no data
+ * arrives for the stream timeout (see setTimeout), returning the count read.
+ */
+int TCPClient::readFully(uint8_t *buffer, size_t size)
+{
+  size_t count = 0;
+  system_tick_t start = millis();
+  while (count < size)
+  {
+      int ret = read(buffer + count, size - count);
+      if (ret > 0)
+      {
+          count += ret;
+          start = millis();
+      }
+      else if (!connected() || (millis() - start) >= _timeout)
+      {
+          break;
+      }
+  }
+  return count;
 }
 
 int TCPClient::peek() 
@@ -182,22 +366,47 @@ int TCPClient::peek()
   return  (bufferCount() || available()) ? _buffer[_offset] : -1;
 }
 
+// The buffered bytes up to the end of the ring, filling it when empty
+size_t TCPClient::peekBuffer(const uint8_t *&data)
+{
+  if (!bufferCount() && !available())
+  {
+      return 0;
+  }
+  size_t count = arraySize(_buffer) - _offset;
+  if (count > _total) count = _total;
+  data = &_buffer[_offset];
+  return count;
+}
+
+void TCPClient::consume(size_t length)
+{
+  if (length > _total) length = _total;
+  _offset = (_offset + length) & (arraySize(_buffer) - 1);
+  _total -= length;
+}
+
+// Send held writes and drop received data
 void TCPClient::flush() 
 {
+  sendPending();
   _offset = 0;
   _total = 0;
 }
 
 void TCPClient::stop() 
 {
+  sendPending();
   DEBUG("_sock %d closesocket", _sock);
 
   if (isOpen(_sock))
   {
       int rv = closesocket(_sock);
       DEBUG("_sock %d closed=%d", _sock, rv);
+      _closeCount[_sock]++;
   }
  _sock = MAX_SOCK_NUM;
+ _nonBlocking = false;
 }
 
 uint8_t TCPClient::connected() 
@@ -26,7 +26,7 @@
 #include "spark_wiring_tcpclient.h"
 #include "spark_wiring_tcpserver.h"
 
-TCPServer::TCPServer(uint16_t port) : _port(port), _sock(MAX_SOCK_NUM), _client(MAX_SOCK_NUM)
+TCPServer::TCPServer(uint16_t port) : _port(port), _sock(MAX_SOCK_NUM), _pending(MAX_SOCK_NUM), _count(0)
 {
 
 }
@@ -56,6 +56,13 @@ void TCPServer::begin()
 		return;
 	}
 
+	// The per-socket tables only reach MAX_SOCK_NUM - 1
+	if (sock >= MAX_SOCK_NUM)
+	{
+		closesocket(sock);
+		return;
+	}
+
 	long optval = SOCK_ON;
 	if (setsockopt(sock, SOL_SOCKET, SOCKOPT_ACCEPT_NONBLOCK, &optval, sizeof(optval)) < 0)
 	{
@@ -67,7 +74,7 @@ void TCPServer::begin()
 		return;
 	}
 
-	if (listen(sock, 0) < 0)
+	if (listen(sock, TCPSERVER_MAX_CLIENTS) < 0)
 	{
 		return;
 	}
@@ -76,6 +83,18 @@ void TCPServer::begin()
 }
 
 TCPClient TCPServer::available()
+{
+	return accept();
+}
+
+/*
+ * Accept the next waiting connection and add it to the table of live
+ * connections. Returns a client for the new connection only, or a client
+ * that is not connected when none is waiting. When the table is full, the
+ * connection idle longest is closed to make room if it has received nothing
+ * for TCPSERVER_IDLE_TIMEOUT; otherwise the new connection is closed at once.
+ */
+TCPClient TCPServer::accept()
 {
 	if(_sock == MAX_SOCK_NUM)
 	{
@@ -85,25 +104,126 @@ TCPClient TCPServer::available()
 	if((!WiFi.ready()) || (_sock == MAX_SOCK_NUM))
 	{
 		_sock = MAX_SOCK_NUM;
-		_client = TCPClient(MAX_SOCK_NUM);
-		return _client;
+		return TCPClient(MAX_SOCK_NUM);
+	}
+
+	int sock = _pending;
+	_pending = MAX_SOCK_NUM;
+
+	// Registered with a SocketPoller, connections are accepted in pollReady()
+	if (sock == MAX_SOCK_NUM && !_poller)
+	{
+		sock = acceptClient();
+	}
+
+	if (sock < 0 || sock == MAX_SOCK_NUM)
+	{
+		return TCPClient(MAX_SOCK_NUM);
+	}
+
+	if (clients() == TCPSERVER_MAX_CLIENTS && !evictIdle())
+	{
+		closesocket(sock);
+		return TCPClient(MAX_SOCK_NUM);
+	}
+
+	_clients[_count].sock = sock;
+	_clients[_count].closeCount = TCPClient::_closeCount[sock];
+	_count++;
+	TCPClient::_lastReceive[sock] = millis();
+
+	return TCPClient(sock);
+}
+
+/*
+ * Number of live connections. Connections that were stopped or closed by
+ * the peer are dropped from the table first.
+ */
+uint8_t TCPServer::clients()
+{
+	for (uint8_t i = 0; i < _count;)
+	{
+		long sock = _clients[i].sock;
+		if (_clients[i].closeCount != TCPClient::_closeCount[sock] ||
+			get_socket_active_status(sock) != SOCKET_STATUS_ACTIVE)
+		{
+			_clients[i] = _clients[--_count];
+		}
+		else
+		{
+			i++;
+		}
+	}
+	return _count;
+}
+
+/*
+ * Close the connection that has gone longest without receiving, if that is
+ * over TCPSERVER_IDLE_TIMEOUT, and drop it from the table. Returns true if
+ * a slot was freed.
+ */
+bool TCPServer::evictIdle()
+{
+	system_tick_t now = millis();
+	uint8_t idlest = 0;
+
+	for (uint8_t i = 1; i < _count; i++)
+	{
+		if (now - TCPClient::_lastReceive[_clients[i].sock] > now - TCPClient::_lastReceive[_clients[idlest].sock])
+		{
+			idlest = i;
+		}
+	}
+
+	if (_count == 0 || now - TCPClient::_lastReceive[_clients[idlest].sock] < TCPSERVER_IDLE_TIMEOUT)
+	{
+		return false;
 	}
 
+	// Through stop(), so clients still holding the socket see it closed
+	TCPClient(_clients[idlest].sock).stop();
+	_clients[idlest] = _clients[--_count];
+	return true;
+}
+
+/*
+ * Live connection 0 .. clients() - 1. Each call returns a new TCPClient with
+ * an empty receive ring, so data one of them has buffered is not seen by
+ * the next; keep the returned client for as long as it is read from.
+ */
+TCPClient TCPServer::client(uint8_t index)
+{
+	return TCPClient(index < _count ? _clients[index].sock : MAX_SOCK_NUM);
+}
+
+int TCPServer::acceptClient()
+{
 	sockaddr tClientAddr;
 	socklen_t tAddrLen = sizeof(tClientAddr);
 
-	int sock = accept(_sock, (sockaddr*)&tClientAddr, &tAddrLen);
+	int sock = ::accept(_sock, (sockaddr*)&tClientAddr, &tAddrLen);
 
-	if (sock < 0)
+	// The per-socket tables only reach MAX_SOCK_NUM - 1, refuse beyond them
+	if (sock >= MAX_SOCK_NUM)
 	{
-		_client = TCPClient(MAX_SOCK_NUM);
+		closesocket(sock);
+		return -1;
 	}
-	else
+	return sock;
+}
+
+long TCPServer::pollSocket()
+{
+	return (WiFi.ready() && _sock != MAX_SOCK_NUM && _pending == MAX_SOCK_NUM) ? _sock : -1;
+}
+
+void TCPServer::pollReady()
+{
+	int sock = acceptClient();
+	if (sock >= 0)
 	{
-		_client = TCPClient(sock);
+		_pending = sock;
 	}
-
-	return _client;
 }
 
 size_t TCPServer::write(uint8_t b) 
@@ -111,7 +231,18 @@ size_t TCPServer::write(uint8_t b)
 	return write(&b, 1);
 }
 
+// Send to every live connection
 size_t TCPServer::write(const uint8_t *buffer, size_t size) 
 {
-	return _client.write(buffer, size);
+	size_t sent = 0;
+	uint8_t count = WiFi.ready() ? clients() : 0;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (send(_clients[i].sock, buffer, size, 0) >= 0)
+		{
+			sent = size;
+		}
+	}
+	return sent;
 }
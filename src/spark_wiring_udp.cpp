@@ -27,6 +27,7 @@
  */
 
 #include "spark_wiring_udp.h"
+#include "pool_alloc.h"
 
 
 static bool inline isOpen(long sd)
@@ -34,11 +35,52 @@ static bool inline isOpen(long sd)
    return sd != MAX_SOCK_NUM;
 }
 
-UDP::UDP() : _sock(MAX_SOCK_NUM)
+UDP::UDP() : _sock(MAX_SOCK_NUM), _buffer(NULL), _bufferSize(RX_BUF_MAX_SIZE), _bufferOwned(false),
+        _offset(0), _total(0), _txCount(0), _txSent(false), _nonBlocking(false)
 {
 
 }
 
+UDP::~UDP()
+{
+        setBuffer(0);
+}
+
+/*
+ * Sets the buffer parsePacket() and read() work from, which is otherwise
+ * RX_BUF_MAX_SIZE bytes taken from the heap on first use. A buffer of size
+ * 0 leaves only receivePacket(), and costs no RAM. Without a buffer given,
+ * one of size bytes is allocated. Returns false if that fails.
+ */
+bool UDP::setBuffer(size_t size, uint8_t *buffer)
+{
+        if (_bufferOwned)
+        {
+            pool_free(_buffer);
+        }
+        flush();
+        _buffer = buffer;
+        _bufferSize = size;
+        _bufferOwned = false;
+
+        return buffer != NULL || size == 0 || reserveBuffer();
+}
+
+// Allocate the default buffer the first time it is needed
+bool UDP::reserveBuffer()
+{
+        if (_buffer == NULL && _bufferSize > 0)
+        {
+            _buffer = (uint8_t *)pool_malloc(_bufferSize);
+            _bufferOwned = (_buffer != NULL);
+            if (_buffer == NULL)
+            {
+                _bufferSize = 0;
+            }
+        }
+        return _buffer != NULL;
+}
+
 uint8_t UDP::begin(uint16_t port) 
 {
         int bound = 0;
@@ -46,9 +88,18 @@ uint8_t UDP::begin(uint16_t port)
 
 	if(WiFi.ready())
 	{
-	   _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-           DEBUG("socket=%d",_sock);
-           if (_sock >= 0)
+	   long sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+           DEBUG("socket=%d",sock);
+
+           // _sock only holds sockets below MAX_SOCK_NUM
+           if (sock >= MAX_SOCK_NUM)
+           {
+               closesocket(sock);
+               sock = -1;
+           }
+           _sock = (sock >= 0) ? sock : MAX_SOCK_NUM;
+           _nonBlocking = false;
+           if (isOpen(_sock))
             {
 
               flush();
@@ -122,13 +173,25 @@ int UDP::beginPacket(IPAddress ip, uint16_t port)
 	_remoteSockAddr.sa_data[5] = _remoteIP._address[3];
 
 	_remoteSockAddrLen = sizeof(_remoteSockAddr);
+	_txCount = 0;
+	_txSent = false;
 
 	return 1;
 }
 
+// Send the datagram held since beginPacket(), 1 on success
 int UDP::endPacket()
 {
-	return 1;
+	int rv = 1;
+	if (_txCount)
+	{
+		rv = sendto(_sock, _txBuffer, _txCount, 0, &_remoteSockAddr, _remoteSockAddrLen);
+		DEBUG("sendto(size=%d)=%d", _txCount, rv);
+		rv = (rv >= 0) ? 1 : 0;
+	}
+	_txCount = 0;
+	_txSent = false;
+	return rv;
 }
 
 size_t UDP::write(uint8_t byte)
@@ -136,51 +199,152 @@ size_t UDP::write(uint8_t byte)
 	return write(&byte, 1);
 }
 
+/*
+ * Writes collect into one datagram that endPacket() sends. A datagram is
+ * never split: a single write larger than UDP_TX_BUF_SIZE goes out at once
+ * as the whole datagram, and a write that would overflow the datagram is
+ * refused. Either way a refused write returns 0 and sets the write error.
+ */
 size_t UDP::write(const uint8_t *buffer, size_t size)
 {
+	if (_txSent || _txCount + size > arraySize(_txBuffer))
+	{
+		if (_txSent || _txCount > 0)
+		{
+			DEBUG("datagram full, write(size=%d) refused", size);
+			setWriteError();
+			return 0;
+		}
+
+		int rv =  sendto(_sock, buffer, size, 0, &_remoteSockAddr, _remoteSockAddrLen);
+		DEBUG("sendto(buffer=%lx, size=%d)=%d",buffer, size , rv);
+		if (rv < 0)
+		{
+			setWriteError();
+			return 0;
+		}
+		_txSent = true;
+		return rv;
+	}
 
-	int rv =  sendto(_sock, buffer, size, 0, &_remoteSockAddr, _remoteSockAddrLen);
-        DEBUG("sendto(buffer=%lx, size=%d)=%d",buffer, size , rv);
-	return rv;
+	memcpy(&_txBuffer[_txCount], buffer, size);
+	_txCount += size;
+	return size;
 }
 
 int UDP::parsePacket()
 {
   // No data buffered
-  if(available() == 0 && WiFi.ready() && isOpen(_sock))
+  if(available() == 0 && reserveBuffer() && poll())
+  {
+      int ret = receive(_buffer, _bufferSize);
+      if (ret > 0)
+      {
+          _offset = 0;
+          _total = ret;
+      }
+  }
+  return available();
+}
+
+/*
+ * Receive the next datagram straight into buffer, skipping the internal
+ * buffer and the copy out of it. At most size bytes are kept, the rest of a
+ * longer datagram is dropped. Returns the length received, 0 if none.
+ */
+int UDP::receivePacket(uint8_t *buffer, size_t size)
+{
+  // Already received by parsePacket() or a SocketPoller
+  if (available())
   {
-      _types_fd_set_cc3000 readSet;
-      timeval timeout;
+      int length = read(buffer, size);
+      flush();
+      return length;
+  }
 
-      FD_ZERO(&readSet);
-      FD_SET(_sock, &readSet);
+  if (poll())
+  {
+      int ret = receive(buffer, size);
+      if (ret > 0)
+      {
+          return ret;
+      }
+  }
+  return 0;
+}
 
-      timeout.tv_sec = 0;
-      timeout.tv_usec = 5000;
+// Wait for a datagram, true if recvfrom() will not block
+bool UDP::poll()
+{
+  if (!WiFi.ready() || !isOpen(_sock))
+  {
+      return false;
+  }
 
-      if (select(_sock + 1, &readSet, NULL, NULL, &timeout) > 0)
+  if (_poller)
+  {
+      // A SocketPoller does the waiting, only pick up what is queued
+      if (!_nonBlocking)
       {
-              if (FD_ISSET(_sock, &readSet))
-              {
+          long optval = SOCK_ON;
+          _nonBlocking = (setsockopt(_sock, SOL_SOCKET, SOCKOPT_RECV_NONBLOCK, &optval, sizeof(optval)) >= 0);
+      }
+      return _nonBlocking;
+  }
 
-                      int ret = recvfrom(_sock, _buffer, arraySize(_buffer), 0, &_remoteSockAddr, &_remoteSockAddrLen);
+  _types_fd_set_cc3000 readSet;
+  timeval timeout;
 
-                      if (ret > 0)
-                      {
-                              _remotePort = _remoteSockAddr.sa_data[0] << 8 | _remoteSockAddr.sa_data[1];
+  FD_ZERO(&readSet);
+  FD_SET(_sock, &readSet);
 
-                              _remoteIP._address[0] = _remoteSockAddr.sa_data[2];
-                              _remoteIP._address[1] = _remoteSockAddr.sa_data[3];
-                              _remoteIP._address[2] = _remoteSockAddr.sa_data[4];
-                              _remoteIP._address[3] = _remoteSockAddr.sa_data[5];
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 5000;
 
-                              _offset = 0;
-                              _total = ret;
-                      }
-              }
-      }
-   }
-   return available();
+  return (select(_sock + 1, &readSet, NULL, NULL, &timeout) > 0) && FD_ISSET(_sock, &readSet);
+}
+
+int UDP::receive(uint8_t *buffer, size_t size)
+{
+  _remoteSockAddrLen = sizeof(_remoteSockAddr);
+  int ret = recvfrom(_sock, buffer, size, 0, &_remoteSockAddr, &_remoteSockAddrLen);
+
+  if (ret > 0)
+  {
+          _remotePort = (uint8_t)_remoteSockAddr.sa_data[0] << 8 | (uint8_t)_remoteSockAddr.sa_data[1];
+
+          _remoteIP._address[0] = _remoteSockAddr.sa_data[2];
+          _remoteIP._address[1] = _remoteSockAddr.sa_data[3];
+          _remoteIP._address[2] = _remoteSockAddr.sa_data[4];
+          _remoteIP._address[3] = _remoteSockAddr.sa_data[5];
+  }
+  return ret;
+}
+
+long UDP::pollSocket()
+{
+  // Without a buffer the poller only wakes the caller, who must then take
+  // the datagram with receivePacket() before the next poll
+  if (_bufferSize == 0)
+  {
+      return (WiFi.ready() && isOpen(_sock)) ? _sock : -1;
+  }
+  return (WiFi.ready() && isOpen(_sock) && available() == 0 && reserveBuffer()) ? _sock : -1;
+}
+
+void UDP::pollReady()
+{
+  if (_buffer == NULL)
+  {
+      return;
+  }
+
+  int ret = receive(_buffer, _bufferSize);
+  if (ret > 0)
+  {
+      _offset = 0;
+      _total = ret;
+  }
 }
 
 int UDP::read()
@@ -205,6 +369,19 @@ int UDP::peek()
      return available() ? _buffer[_offset] : -1;
 }
 
+// The rest of the current datagram
+size_t UDP::peekBuffer(const uint8_t *&data)
+{
+  data = &_buffer[_offset];
+  return available();
+}
+
+void UDP::consume(size_t length)
+{
+  if (length > (size_t) available()) length = available();
+  _offset += length;
+}
+
 void UDP::flush()
 {
   _offset = 0;
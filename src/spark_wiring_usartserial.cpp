@@ -39,23 +39,81 @@ STM32_USART_Info USART_MAP[TOTAL_USARTS] =
    * TX pin
    * RX pin
    * GPIO Remap (RCC_APB2Periph_USART2 or GPIO_Remap_None )
+   * TX DMA channel, RX DMA channel and its interrupt number; USART1's
+   *   channels 4 and 5 carry the CC3000 SPI, so it has none
    * <tx_buffer pointer> used internally and does not appear below
    * <rx_buffer pointer> used internally and does not appear below
+   * <DMA state> used internally and does not appear below
    */
-  { USART2, &RCC->APB1ENR, RCC_APB1Periph_USART2, USART2_IRQn, TX, RX, GPIO_Remap_None },
-  { USART1, &RCC->APB2ENR, RCC_APB2Periph_USART1, USART1_IRQn, D1, D0, GPIO_Remap_USART1 }
+  { USART2, &RCC->APB1ENR, RCC_APB1Periph_USART2, USART2_IRQn, TX, RX, GPIO_Remap_None,
+    DMA1_Channel7, DMA1_Channel6, DMA1_Channel6_IRQn },
+  { USART1, &RCC->APB2ENR, RCC_APB2Periph_USART1, USART1_IRQn, D1, D0, GPIO_Remap_USART1,
+    NULL, NULL, DMA1_Channel6_IRQn }
 };
 
 
 inline void store_char(unsigned char c, Ring_Buffer *buffer)
 {
-        unsigned i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
+        unsigned i = (unsigned int)(buffer->head + 1) % buffer->size;
 
 	if (i != buffer->tail)
 	{
 		buffer->buffer[buffer->head] = c;
 		buffer->head = i;
 	}
+	else
+	{
+		buffer->dropped++;
+	}
+}
+
+// Moves the receive ring's head up to where the DMA has written. Runs at
+// the USART's priority, on an idle line and every half ring, so the DMA is
+// never a whole ring ahead between calls. The tail belongs to the reader,
+// so when the DMA has caught up with it the overwritten bytes are only
+// counted as dropped.
+static void USART_DMA_Receive_Update(STM32_USART_Info *usartMap)
+{
+	Ring_Buffer *rx = usartMap->usart_rx_buffer;
+	unsigned int head = (rx->size - DMA_GetCurrDataCounter(usartMap->usart_rx_dma)) % rx->size;
+	unsigned int received = (rx->size + head - rx->head) % rx->size;
+	unsigned int used = (rx->size + rx->head - rx->tail) % rx->size;
+
+	if (used + received > rx->size - 1)
+	{
+		rx->dropped += used + received - (rx->size - 1);
+	}
+	rx->head = head;
+}
+
+// Finishes the DMA transfer under way, if any, and starts one for the next
+// contiguous stretch of the transmit ring. The USART's transfer complete
+// interrupt calls it again when that has gone out.
+static void USART_DMA_Transmit_Next(STM32_USART_Info *usartMap)
+{
+	Ring_Buffer *tx = usartMap->usart_tx_buffer;
+	DMA_Channel_TypeDef *channel = usartMap->usart_tx_dma;
+
+	DMA_Cmd(channel, DISABLE);
+	tx->tail = (tx->tail + usartMap->usart_tx_dma_length) % tx->size;
+
+	unsigned int head = tx->head;
+	unsigned int tail = tx->tail;
+
+	if (head == tail)
+	{
+		usartMap->usart_tx_dma_length = 0;
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_TC, DISABLE);
+		return;
+	}
+
+	usartMap->usart_tx_dma_length = (head > tail) ? head - tail : tx->size - tail;
+	channel->CMAR = (uint32_t)&tx->buffer[tail];
+	channel->CNDTR = usartMap->usart_tx_dma_length;
+
+	USART_ClearFlag(usartMap->usart_peripheral, USART_FLAG_TC);
+	DMA_Cmd(channel, ENABLE);
+	USART_ITConfig(usartMap->usart_peripheral, USART_IT_TC, ENABLE);
 }
 
 // Initialize Class Variables //////////////////////////////////////////////////
@@ -70,9 +128,15 @@ USARTSerial::USARTSerial(STM32_USART_Info *usartMapPtr)
 
         usartMap->usart_rx_buffer = &_rx_buffer;
         usartMap->usart_tx_buffer = &_tx_buffer;
+        usartMap->usart_dma = false;
+        usartMap->usart_tx_dma_length = 0;
 
         memset(&_rx_buffer, 0, sizeof(Ring_Buffer));
         memset(&_tx_buffer, 0, sizeof(Ring_Buffer));
+        _rx_buffer.buffer = _rx_data;
+        _rx_buffer.size = sizeof(_rx_data);
+        _tx_buffer.buffer = _tx_data;
+        _tx_buffer.size = sizeof(_tx_data);
 
         transmitting = false;
 }
@@ -141,6 +205,88 @@ void USARTSerial::begin(unsigned long baud, byte config)
 
 }
 
+/*
+ * Moves data with DMA instead of an interrupt per byte, after begin().
+ * Received bytes go straight into the receive ring, so none are lost while
+ * interrupts are off, and the idle line interrupt hands over each burst
+ * once it ends. Each contiguous stretch of the transmit ring goes out as
+ * one transfer. Only Serial1 has DMA channels to use, and it borrows them:
+ * receive takes channel 6, which Wire also uses, and transmit takes
+ * channel 7, which NeoPixel DMA output also uses. It returns false,
+ * changing nothing, while either channel is already enabled.
+ */
+bool USARTSerial::beginDMA(void)
+{
+	if (!USARTSerial_Enabled || usartMap->usart_tx_dma == NULL)
+	{
+		return false;
+	}
+
+	if (usartMap->usart_dma)
+	{
+		return true;
+	}
+
+	// Leave the channels alone while another driver has one running
+	if ((usartMap->usart_tx_dma->CCR & DMA_CCR1_EN)
+			|| (usartMap->usart_rx_dma->CCR & DMA_CCR1_EN))
+	{
+		return false;
+	}
+
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	// Stop taking bytes by interrupt, and start afresh
+	USART_ITConfig(usartMap->usart_peripheral, USART_IT_RXNE, DISABLE);
+	USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, DISABLE);
+	flush();
+	_rx_buffer.head = _rx_buffer.tail = 0;
+
+	DMA_InitTypeDef DMA_InitStructure;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&usartMap->usart_peripheral->DR;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+	DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+
+	// Receive into the ring, round and round
+	DMA_DeInit(usartMap->usart_rx_dma);
+	DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)_rx_buffer.buffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+	DMA_InitStructure.DMA_BufferSize = _rx_buffer.size;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_Init(usartMap->usart_rx_dma, &DMA_InitStructure);
+	DMA_ITConfig(usartMap->usart_rx_dma, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	// Transmit one stretch at a time, the address and length are set per transfer
+	DMA_DeInit(usartMap->usart_tx_dma);
+	DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)_tx_buffer.buffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+	DMA_InitStructure.DMA_BufferSize = 1;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_Init(usartMap->usart_tx_dma, &DMA_InitStructure);
+
+	// The half and full ring interrupts share the USART's priority, so
+	// they never preempt its handler
+	NVIC_InitTypeDef NVIC_InitStructure;
+	NVIC_InitStructure.NVIC_IRQChannel = usartMap->usart_rx_dma_int_n;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART2_IRQ_PRIORITY;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	usartMap->usart_tx_dma_length = 0;
+	usartMap->usart_dma = true;
+
+	USART_DMACmd(usartMap->usart_peripheral, USART_DMAReq_Rx | USART_DMAReq_Tx, ENABLE);
+	DMA_Cmd(usartMap->usart_rx_dma, ENABLE);
+	USART_ITConfig(usartMap->usart_peripheral, USART_IT_IDLE, ENABLE);
+
+	return true;
+}
+
 void USARTSerial::end()
 {
 	// wait for transmission of outgoing data
@@ -150,6 +296,17 @@ void USARTSerial::end()
 	USART_ITConfig(usartMap->usart_peripheral, USART_IT_RXNE, DISABLE);
 	USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, DISABLE);
 
+	if (usartMap->usart_dma)
+	{
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_IDLE, DISABLE);
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_TC, DISABLE);
+		USART_DMACmd(usartMap->usart_peripheral, USART_DMAReq_Rx | USART_DMAReq_Tx, DISABLE);
+		DMA_Cmd(usartMap->usart_rx_dma, DISABLE);
+		DMA_Cmd(usartMap->usart_tx_dma, DISABLE);
+		NVIC_DisableIRQ(usartMap->usart_rx_dma_int_n);
+		usartMap->usart_dma = false;
+	}
+
 	// Disable the USART
 	USART_Cmd(usartMap->usart_peripheral, DISABLE);
 
@@ -176,7 +333,7 @@ void USARTSerial::end()
 
 int USARTSerial::available(void)
 {
-	return (unsigned int)(SERIAL_BUFFER_SIZE + _rx_buffer.head - _rx_buffer.tail) % SERIAL_BUFFER_SIZE;
+	return (unsigned int)(_rx_buffer.size + _rx_buffer.head - _rx_buffer.tail) % _rx_buffer.size;
 }
 
 int USARTSerial::peek(void)
@@ -201,11 +358,29 @@ int USARTSerial::read(void)
 	else
 	{
 		unsigned char c = _rx_buffer.buffer[_rx_buffer.tail];
-		_rx_buffer.tail = (unsigned int)(_rx_buffer.tail + 1) % SERIAL_BUFFER_SIZE;
+		_rx_buffer.tail = (unsigned int)(_rx_buffer.tail + 1) % _rx_buffer.size;
 		return c;
 	}
 }
 
+// The received bytes up to the end of the ring buffer
+size_t USARTSerial::peekBuffer(const uint8_t *&data)
+{
+	unsigned int head = _rx_buffer.head;
+	unsigned int tail = _rx_buffer.tail;
+	data = &_rx_buffer.buffer[tail];
+	return (head >= tail) ? head - tail : _rx_buffer.size - tail;
+}
+
+void USARTSerial::consume(size_t length)
+{
+	if (length > (size_t)available())
+	{
+		length = available();
+	}
+	_rx_buffer.tail = (unsigned int)(_rx_buffer.tail + length) % _rx_buffer.size;
+}
+
 void USARTSerial::flush()
 {
 	// Loop until USART DR register is empty
@@ -215,45 +390,116 @@ void USARTSerial::flush()
 	transmitting = false;
 }
 
+// Moves the transmit ring along by hand, for when its interrupt is not
+// being serviced: interrupts are off, or this was called from a higher
+// priority interrupt
+static void USART_Transmit_Poll(STM32_USART_Info *usartMap)
+{
+	Ring_Buffer *tx = usartMap->usart_tx_buffer;
+
+	if (usartMap->usart_dma)
+	{
+		// protect for good measure
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_TC, DISABLE);
+		if (usartMap->usart_tx_dma_length == 0 || DMA_GetCurrDataCounter(usartMap->usart_tx_dma) == 0)
+		{
+			// Start the next stretch, this unprotects if there is one
+			USART_DMA_Transmit_Next(usartMap);
+		}
+		else
+		{
+			USART_ITConfig(usartMap->usart_peripheral, USART_IT_TC, ENABLE);
+		}
+	}
+	else if (USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TXE) && USART_GetFlagStatus(usartMap->usart_peripheral, USART_FLAG_TXE))
+	{
+		// protect for good measure
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, DISABLE);
+		// Write out a byte
+		USART_SendData(usartMap->usart_peripheral, tx->buffer[tx->tail]);
+		tx->tail = (tx->tail + 1) % tx->size;
+		// unprotect
+		USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, ENABLE);
+	}
+}
+
 size_t USARTSerial::write(uint8_t c)
 {
+	return write(&c, 1);
+}
 
+size_t USARTSerial::write(const uint8_t *buffer, size_t size)
+{
         // interrupts are off and data in queue;
-        if ((USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TXE) == RESET)
+        if (!usartMap->usart_dma
+            && (USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TXE) == RESET)
             && _tx_buffer.head != _tx_buffer.tail) {
             // Get him busy
             USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, ENABLE);
         }
 
-        unsigned i = (_tx_buffer.head + 1) % SERIAL_BUFFER_SIZE;
-
-	// If the output buffer is full, there's nothing for it other than to
-        // wait for the interrupt handler to empty it a bit
-        //         no space so       or  Called Off Panic with interrupt off get the message out!
-        //         make space                     Enter Polled IO mode
-        while (i == _tx_buffer.tail || ((__get_PRIMASK() & 1) && _tx_buffer.head != _tx_buffer.tail) ) {
-            // Interrupts are on but they are not being serviced because this was called from a higher
-            // Priority interrupt
-
-            if (USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TXE) && USART_GetFlagStatus(usartMap->usart_peripheral, USART_FLAG_TXE))
-            {
-                // protect for good measure
-                USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, DISABLE);
-                // Write out a byte
-                USART_SendData(usartMap->usart_peripheral,  _tx_buffer.buffer[_tx_buffer.tail++]);
-                _tx_buffer.tail %= SERIAL_BUFFER_SIZE;
-                // unprotect
-                USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, ENABLE);
-            }
-        }
+	size_t written = 0;
+
+	while (written < size)
+	{
+		unsigned int head = _tx_buffer.head;
+		unsigned int tail = _tx_buffer.tail;
+		unsigned int space = (_tx_buffer.size + tail - head - 1) % _tx_buffer.size;
+
+		// If the output buffer is full, there's nothing for it other than to
+		// wait for the interrupt handler to empty it a bit
+		//         no space so       or  Called Off Panic with interrupt off get the message out!
+		//         make space                     Enter Polled IO mode
+		if (space == 0 || ((__get_PRIMASK() & 1) && head != tail))
+		{
+			USART_Transmit_Poll(usartMap);
+			continue;
+		}
+
+		// Copy up to the end of the ring, the rest goes on the next pass
+		unsigned int length = _tx_buffer.size - head;
+		if (length > space)
+		{
+			length = space;
+		}
+		if (length > size - written)
+		{
+			length = size - written;
+		}
+		memcpy(&_tx_buffer.buffer[head], buffer + written, length);
+		_tx_buffer.head = (head + length) % _tx_buffer.size;
+		written += length;
+		transmitting = true;
+
+		if (!usartMap->usart_dma)
+		{
+			USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, ENABLE);
+		}
+		else if (usartMap->usart_tx_dma_length == 0)
+		{
+			// Nothing under way, so the transfer complete interrupt is off
+			// and will not race us for the ring
+			USART_DMA_Transmit_Next(usartMap);
+		}
+	}
 
-        _tx_buffer.buffer[_tx_buffer.head] = c;
-        _tx_buffer.head = i;
-	transmitting = true;
-        USART_ITConfig(usartMap->usart_peripheral, USART_IT_TXE, ENABLE);
+	// Polled IO sends everything before returning, as a byte at a time did
+	while ((__get_PRIMASK() & 1) && _tx_buffer.head != _tx_buffer.tail)
+	{
+		USART_Transmit_Poll(usartMap);
+	}
+
+	return written;
+}
 
+uint32_t USARTSerial::rxDropped(void)
+{
+	return _rx_buffer.dropped;
+}
 
-	return 1;
+uint32_t USARTSerial::rxOverruns(void)
+{
+	return _rx_buffer.overruns;
 }
 
 USARTSerial::operator bool() {
@@ -266,11 +512,41 @@ static void USART_Interrupt_Handler(STM32_USART_Info *usartMap)
 {
   if(USART_GetITStatus(usartMap->usart_peripheral, USART_IT_RXNE) != RESET)
   {
+    // A byte arrived before the last one was read, so it was lost
+    if (USART_GetFlagStatus(usartMap->usart_peripheral, USART_FLAG_ORE) != RESET)
+    {
+      usartMap->usart_rx_buffer->overruns++;
+    }
     // Read byte from the receive data register
     unsigned char c = USART_ReceiveData(usartMap->usart_peripheral);
     store_char(c, usartMap->usart_rx_buffer);
   }
 
+  if(USART_GetITStatus(usartMap->usart_peripheral, USART_IT_IDLE) != RESET)
+  {
+    if (USART_GetFlagStatus(usartMap->usart_peripheral, USART_FLAG_ORE) != RESET)
+    {
+      usartMap->usart_rx_buffer->overruns++;
+    }
+    // Reading the data register after the status clears the idle flag
+    USART_ReceiveData(usartMap->usart_peripheral);
+    // The line went quiet, so hand over what the DMA has received
+    USART_DMA_Receive_Update(usartMap);
+  }
+
+  if(USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TC) != RESET)
+  {
+    if (DMA_GetCurrDataCounter(usartMap->usart_tx_dma) == 0)
+    {
+      // The DMA transfer has gone out, start on the next one
+      USART_DMA_Transmit_Next(usartMap);
+    }
+    else
+    {
+      USART_ClearITPendingBit(usartMap->usart_peripheral, USART_IT_TC);
+    }
+  }
+
   if(USART_GetITStatus(usartMap->usart_peripheral, USART_IT_TXE) != RESET)
   {
     // Write byte to the transmit data register
@@ -282,8 +558,8 @@ static void USART_Interrupt_Handler(STM32_USART_Info *usartMap)
     else
     {
       // There is more data in the output buffer. Send the next byte
-      USART_SendData(usartMap->usart_peripheral, usartMap->usart_tx_buffer->buffer[usartMap->usart_tx_buffer->tail++]);
-      usartMap->usart_tx_buffer->tail %= SERIAL_BUFFER_SIZE;
+      USART_SendData(usartMap->usart_peripheral, usartMap->usart_tx_buffer->buffer[usartMap->usart_tx_buffer->tail]);
+      usartMap->usart_tx_buffer->tail = (usartMap->usart_tx_buffer->tail + 1) % usartMap->usart_tx_buffer->size;
     }
   }
 }
@@ -316,6 +592,20 @@ void Wiring_USART1_Interrupt_Handler(void)
   USART_Interrupt_Handler(&USART_MAP[USART_D1_D0]);
 }
 
+// Serial1 receive DMA interrupt handler, once per half of the ring
+/*******************************************************************************
+* Function Name  : Wiring_DMA1_Channel6_Interrupt_Handler (Declared as weak in stm32_it.cpp)
+* Description    : This function handles DMA1 Channel 6 interrupt request.
+* Input          : None.
+* Output         : None.
+* Return         : None.
+*******************************************************************************/
+void Wiring_DMA1_Channel6_Interrupt_Handler(void)
+{
+  DMA_ClearITPendingBit(DMA1_IT_GL6);
+  USART_DMA_Receive_Update(&USART_MAP[USART_TX_RX]);
+}
+
 bool USARTSerial::isEnabled() {
 	return USARTSerial_Enabled;
 }
@@ -59,11 +59,26 @@ int USBSerial::available()
 	return USB_USART_Available_Data();
 }
 
+// Data received from the host, up to where the ring wraps
+size_t USBSerial::peekBuffer(const uint8_t *&data)
+{
+	return USB_USART_Peek_Data(&data);
+}
+
+void USBSerial::consume(size_t length)
+{
+	USB_USART_Skip_Data(length);
+}
+
 size_t USBSerial::write(uint8_t byte)
 {
-	USB_USART_Send_Data(byte);
+	return USB_USART_Send_Buffer(&byte, 1);
+}
 
-	return 1;
+// Queues the whole buffer at once, returning how much fitted
+size_t USBSerial::write(const uint8_t *buffer, size_t size)
+{
+	return USB_USART_Send_Buffer(buffer, size);
 }
 
 void USBSerial::flush()
@@ -73,7 +88,8 @@ void USBSerial::flush()
 
 int USBSerial::peek()
 {
-	return -1;
+	const uint8_t *data;
+	return USB_USART_Peek_Data(&data) ? data[0] : -1;
 }
 
 // Preinstantiate Objects //////////////////////////////////////////////////////
@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @file    stack_monitor.cpp
+ * @author  Spark Labs
+ * @version V1.0.0
+ * @date    19-Oct-2026
+ * @brief   Stack painting, high-water marks and the stack guard zone
+ ******************************************************************************
+  Copyright (c) 2013 Spark Labs, Inc.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, either
+  version 3 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, see <http://www.gnu.org/licenses/>.
+  ******************************************************************************
+ */
+
+
+#include "debug.h"
+#include "stack_monitor.h"
+
+/*
+ * The stack runs down from _estack towards __Stack_Init, both calculated by
+ * the linker (../linker/linker_stm32f10x_md*.ld). The heap stops short of
+ * __Stack_Init, see _sbrk().
+ */
+extern uint32_t __Stack_Init, _estack;
+
+// The deepest word the stack is known to have reached, NULL before a scan
+static uint32_t *lowWater;
+
+static inline uint32_t *stack_pointer(void)
+{
+	uint32_t *sp;
+	__asm__ volatile ("mov %0, sp" : "=r" (sp));
+	return sp;
+}
+
+/*
+ * Called from SparkCoreConfig(), before the constructors run and with
+ * interrupts still off, so everything below the stack pointer is free.
+ */
+void stack_paint(void)
+{
+	uint32_t *sp = stack_pointer();
+
+	for (uint32_t *p = &__Stack_Init; p < sp; p++)
+	{
+		*p = STACK_PAINT;
+	}
+}
+
+/*
+ * Scans up from the bottom for the first word that lost its paint. The
+ * stack only ever gets deeper, so the scan stops at the last mark found.
+ */
+static uint32_t *stack_low_water(void)
+{
+	uint32_t *p = &__Stack_Init;
+	uint32_t *limit = lowWater ? lowWater : &_estack;
+
+	while (p < limit && *p == STACK_PAINT)
+	{
+		p++;
+	}
+	lowWater = p;
+	return p;
+}
+
+void stack_stats(stack_stats_t *stats)
+{
+	uint32_t *low = stack_low_water();
+
+	stats->size = (uint8_t *)&_estack - (uint8_t *)&__Stack_Init;
+	stats->in_use = (uint8_t *)&_estack - (uint8_t *)stack_pointer();
+	stats->high_water = (uint8_t *)&_estack - (uint8_t *)low;
+	stats->headroom = (uint8_t *)low - (uint8_t *)&__Stack_Init;
+}
+
+uint32_t stack_headroom(void)
+{
+	return (uint8_t *)stack_low_water() - (uint8_t *)&__Stack_Init;
+}
+
+/*
+ * Called from the SysTick handler. The interrupted code's stack pointer
+ * must be above the guard zone and the zone must still hold its paint;
+ * a frame that skips over the whole zone without writing to it is missed.
+ */
+void stack_guard_check(void)
+{
+	uint32_t *guardEnd = &__Stack_Init + STACK_GUARD_SIZE / sizeof(uint32_t);
+	bool breached = stack_pointer() < guardEnd;
+
+	for (uint32_t *p = &__Stack_Init; p < guardEnd && !breached; p++)
+	{
+		breached = *p != STACK_PAINT;
+	}
+
+	if (breached)
+	{
+		PANIC(OutOfHeap,"Stack Overflow");
+	}
+}
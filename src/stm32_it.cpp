@@ -30,6 +30,7 @@
 #include "debug.h"
 #include "stm32_it.h"
 #include "main.h"
+#include "stack_monitor.h"
 #include "usb_lib.h"
 #include "usb_istr.h"
 
@@ -48,6 +49,7 @@ extern __IO uint16_t BUTTON_DEBOUNCED_TIME[];
 void Wiring_ADC1_2_Interrupt_Handler(void) __attribute__ ((weak));
 void Wiring_USART1_Interrupt_Handler(void) __attribute__ ((weak));
 void Wiring_USART2_Interrupt_Handler(void) __attribute__ ((weak));
+void Wiring_DMA1_Channel6_Interrupt_Handler(void) __attribute__ ((weak));
 void Wiring_I2C1_EV_Interrupt_Handler(void) __attribute__ ((weak));
 void Wiring_I2C1_ER_Interrupt_Handler(void) __attribute__ ((weak));
 void Wiring_SPI1_Interrupt_Handler(void) __attribute__ ((weak));
@@ -272,6 +274,10 @@ void SysTick_Handler(void)
 {
 	System1MsTick();
 	Timing_Decrement();
+
+#ifdef STACK_GUARD_CHECK_ENABLE
+	stack_guard_check();
+#endif
 }
 
 /******************************************************************************/
@@ -721,6 +727,21 @@ void DMA1_Channel5_IRQHandler(void)
 	SPI_DMA_IntHandler();
 }
 
+/*******************************************************************************
+ * Function Name  : DMA1_Channel6_IRQHandler
+ * Description    : This function handles USART2_RX_DMA interrupt request.
+ * Input          : None
+ * Output         : None
+ * Return         : None
+ *******************************************************************************/
+void DMA1_Channel6_IRQHandler(void)
+{
+	if(NULL != Wiring_DMA1_Channel6_Interrupt_Handler)
+	{
+		Wiring_DMA1_Channel6_Interrupt_Handler();
+	}
+}
+
 /*******************************************************************************
 * Function Name  : USB_LP_CAN1_RX0_IRQHandler
 * Description    : This function handles USB Low Priority interrupts
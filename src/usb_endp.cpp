@@ -24,6 +24,7 @@
 */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "main.h"
 extern "C" {
 #include "usb_lib.h"
@@ -43,14 +44,18 @@ extern "C" {
 /* Private variables ---------------------------------------------------------*/
 
 extern  uint8_t USART_Rx_Buffer[];
-extern uint32_t USART_Rx_ptr_out;
+extern volatile uint32_t USART_Rx_ptr_out;
 extern uint32_t USART_Rx_length;
 
 extern uint8_t USB_Rx_Buffer[];
 extern uint16_t USB_Rx_length;
-extern uint16_t USB_Rx_ptr;
+extern uint8_t USB_Rx_Ring[];
+extern volatile uint32_t USB_Rx_ring_in;
+extern volatile uint32_t USB_Rx_ring_out;
+extern uint32_t USB_Rx_Dropped;
 
 extern uint8_t  USB_Tx_State;
+extern volatile uint8_t USB_Tx_Stalled;
 extern uint8_t  USB_Rx_State;
 
 /* Private function prototypes -----------------------------------------------*/
@@ -68,6 +73,9 @@ void EP1_IN_Callback (void)
   uint16_t USB_Tx_ptr;
   uint16_t USB_Tx_length;
   
+  /* The host took a packet, so writes may wait for it again */
+  USB_Tx_Stalled = 0;
+
   if (USB_Tx_State == 1)
   {
     if (USART_Rx_length == 0) 
@@ -107,9 +115,9 @@ void EP1_IN_Callback (void)
 *******************************************************************************/
 void EP3_OUT_Callback(void)
 {
-  USB_Rx_State = 1;
-
-  USB_Rx_ptr = 0;
+  uint32_t in = USB_Rx_ring_in;
+  uint32_t start = in % USB_RX_RING_SIZE;
+  uint32_t first;
 
   /* Get the number of received data on the selected Endpoint */
   USB_Rx_length = GetEPRxCount(ENDP3);
@@ -117,8 +125,34 @@ void EP3_OUT_Callback(void)
   /* Use the memory interface function to write to the selected endpoint */
   PMAToUserBufferCopy(USB_Rx_Buffer, ENDP3_RXADDR, USB_Rx_length);
 
-  /* USB data should be immediately processed, this allow next USB traffic being
-  NAKed till the end of the processing */
+  /* Queue the packet, in two pieces where the ring wraps. The endpoint is
+  only enabled with room for a whole packet, except after a bus reset */
+  if (USB_RX_RING_SIZE - (in - USB_Rx_ring_out) >= USB_Rx_length)
+  {
+    first = USB_RX_RING_SIZE - start;
+    if (first > USB_Rx_length)
+    {
+      first = USB_Rx_length;
+    }
+    memcpy(&USB_Rx_Ring[start], USB_Rx_Buffer, first);
+    memcpy(USB_Rx_Ring, USB_Rx_Buffer + first, USB_Rx_length - first);
+    USB_Rx_ring_in = in + USB_Rx_length;
+  }
+  else
+  {
+    USB_Rx_Dropped += USB_Rx_length;
+  }
+
+  /* Take the next packet at once if it fits, otherwise it is NAKed until
+  the application reads enough (USB_USART_Resume_Receive) */
+  if (USB_RX_RING_SIZE - (USB_Rx_ring_in - USB_Rx_ring_out) >= VIRTUAL_COM_PORT_DATA_SIZE)
+  {
+    SetEPRxValid(ENDP3);
+  }
+  else
+  {
+    USB_Rx_State = 1;
+  }
 }
 
 
@@ -0,0 +1,155 @@
+#include "catch.hpp"
+#include "clock-sync.h"
+
+#include <stdlib.h>
+
+// A software stand-in for the leader: a clock running at a fixed offset and
+// rate from the local one, reached over a link with jittery, asymmetric delay.
+struct FakeLeader {
+    int32_t offset;
+    double skew;
+    uint32_t start;
+
+    uint32_t at(uint32_t local) const {
+        return local + offset + (int32_t)((int32_t)(local - start) * skew);
+    }
+};
+
+static void exchange(ClockSync& sync, const FakeLeader& leader, uint32_t& now) {
+    uint32_t t0 = now;
+    now += 500 + rand() % 4000;         // uplink
+    uint32_t t1 = leader.at(now);
+    now += 50;                          // leader processing
+    uint32_t t2 = leader.at(now);
+    now += 500 + rand() % 4000;         // downlink
+    sync.addSample(t0, t1, t2, now);
+}
+
+SCENARIO("ClockSync tracks a leader with a fixed offset", "[clocksync]") {
+    ClockSync sync;
+    FakeLeader leader = { 123456789, 0, 0 };
+    uint32_t now = 1000;
+    srand(1);
+
+    REQUIRE(!sync.synced());
+
+    WHEN("Exchanging timestamps once a second") {
+        for (int i = 0; i < 20; i++) {
+            exchange(sync, leader, now);
+            now += 1000000;
+        }
+
+        THEN("Times convert both ways to within a millisecond") {
+            REQUIRE(sync.synced());
+            CHECK(abs((int32_t)(sync.toLeader(now) - leader.at(now))) < 1000);
+            CHECK(abs((int32_t)(sync.toLocal(leader.at(now)) - now)) < 1000);
+        }
+    }
+}
+
+SCENARIO("ClockSync compensates for a skewed leader clock", "[clocksync]") {
+    ClockSync sync;
+    uint32_t now = 0xFFF00000;                  // wraps during the test
+    FakeLeader leader = { -5000000, 100e-6, now };  // 100 ppm fast
+    srand(2);
+
+    WHEN("Exchanging timestamps once a second for a minute") {
+        for (int i = 0; i < 60; i++) {
+            exchange(sync, leader, now);
+            now += 1000000;
+        }
+
+        THEN("The skew is estimated") {
+            CHECK(sync.getSkew() > 80e-6);
+            CHECK(sync.getSkew() < 120e-6);
+        }
+
+        THEN("A presentation time a second ahead lands within a millisecond") {
+            uint32_t target = now + 1000000;
+            uint32_t local = sync.toLocal(leader.at(target));
+            CHECK(abs((int32_t)(local - target)) < 1000);
+        }
+    }
+}
+
+// One pass of the cube's loop: a 5 ms select plus handling what arrived,
+// as SYNC_PASS_TIME in l3d-cube.h
+#define PASS_TIME 7000
+
+// Runs passes of random length from now until presentWait() says to show a
+// frame due at local time at, and returns the local time it is shown.
+static uint32_t latch(uint32_t& now, uint32_t at) {
+    while (true) {
+        int32_t wait = presentWait(now, at, PASS_TIME);
+        if (wait >= 0) {
+            now += wait;
+            return now;
+        }
+        now += 1 + rand() % PASS_TIME;
+    }
+}
+
+SCENARIO("Cubes show a frame within a millisecond of each other", "[clocksync]") {
+    ClockSync sync;
+    uint32_t now = 0xFFFF0000;                  // wraps during the test
+    FakeLeader leader = { 77777777, 50e-6, now };
+    srand(3);
+
+    for (int i = 0; i < 30; i++) {
+        exchange(sync, leader, now);
+        now += 1000000;
+    }
+
+    WHEN("The leader schedules frames 30 ms ahead") {
+        int32_t worst = 0;
+
+        for (int frame = 0; frame < 200; frame++) {
+            uint32_t leaderNow = leader.at(now);
+            uint32_t presentAt = leaderNow + 30000;
+
+            // the leader latches on its own clock
+            uint32_t leaderLocal = leaderNow;
+            CHECK(latch(leaderLocal, presentAt) == presentAt);
+
+            // the follower converts the time and latches on its clock
+            uint32_t shown = latch(now, sync.toLocal(presentAt));
+            int32_t error = abs((int32_t)(leader.at(shown) - presentAt));
+            if (error > worst) worst = error;
+
+            now += rand() % 40000;
+        }
+
+        THEN("Every follower latch is within a millisecond") {
+            CHECK(worst < 1000);
+        }
+    }
+
+    WHEN("A frame is already due") {
+        uint32_t at = now - 500;
+        THEN("It is shown at once") {
+            CHECK(presentWait(now, at, PASS_TIME) == 0);
+        }
+    }
+
+    WHEN("A frame is due after the next pass") {
+        THEN("It is left for a later pass") {
+            CHECK(presentWait(now, now + PASS_TIME + 1, PASS_TIME) == -1);
+            CHECK(presentWait(now, now + PASS_TIME, PASS_TIME) == PASS_TIME);
+        }
+    }
+}
+
+SCENARIO("ClockSync ignores malformed exchanges", "[clocksync]") {
+    ClockSync sync;
+
+    // reply received before the request was sent
+    sync.addSample(2000, 5000, 5010, 1000);
+    REQUIRE(!sync.synced());
+
+    sync.addSample(1000, 5000, 5010, 2000);
+    REQUIRE(sync.synced());
+    CHECK(sync.delay() == 990);
+
+    sync.reset();
+    REQUIRE(!sync.synced());
+}
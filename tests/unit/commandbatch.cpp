@@ -0,0 +1,34 @@
+#include "catch.hpp"
+
+#include "command-batch.h"
+
+TEST_CASE("Command batches are counted when the batch is well formed") {
+    const uint8_t batch[] = {
+        OP_CLEAR, 0, 0, 0,
+        OP_VOXEL, 1, 2, 3, 255, 0, 0,
+        OP_BOX, 0x80, 0x80, 0x80, 0x7F, 0x7F, 0x7F, 0, 255, 0,
+        OP_NOP,
+        OP_PRESENT,
+    };
+
+    REQUIRE(checkCommands(batch, sizeof(batch)) == 5);
+    REQUIRE(checkCommands(batch, 0) == 0);
+}
+
+TEST_CASE("Command batches reject unknown opcodes and short arguments") {
+    REQUIRE(commandLength(OP_BOX) == 9);
+    REQUIRE(commandLength(OP_PRESENT + 1) == -1);
+
+    const uint8_t unknown[] = { OP_NOP, OP_PRESENT + 1 };
+    REQUIRE(checkCommands(unknown, sizeof(unknown)) == -1);
+
+    const uint8_t sphere[] = { OP_SPHERE, 4, 4, 4, 3, 255, 255, 255 };
+    REQUIRE(checkCommands(sphere, sizeof(sphere)) == 1);
+    for (size_t cut = 1; cut < sizeof(sphere); cut++) {
+        REQUIRE(checkCommands(sphere, cut) == -1);
+    }
+
+    // an argument byte is never read as the next opcode
+    const uint8_t plane[] = { OP_PLANE, 0, 0, 0xFF, 0xFF, 0xFF, OP_CLEAR };
+    REQUIRE(checkCommands(plane, sizeof(plane)) == -1);
+}
@@ -0,0 +1,61 @@
+#include <string.h>
+#include <string>
+#include "catch.hpp"
+
+#include "spark_wiring_print.h"
+#include "spark_wiring_string.h"
+#include "frame-arena.h"
+#include "frame-assembler.h"
+
+TEST_CASE("Frame arena hands out lasting buffers and scratch from opposite ends") {
+    static uint8_t store[64] __attribute__((aligned(4)));
+    FrameArena arena(store, sizeof(store));
+
+    uint8_t *frame = arena.take(30);
+    REQUIRE(frame == store);
+    REQUIRE(arena.used() == 32);
+
+    uint8_t *scratch = arena.scratch(8);
+    REQUIRE(scratch == store + 56);
+    REQUIRE(arena.scratch(30) == NULL);
+    REQUIRE(arena.overflows == 1);
+
+    arena.startFrame();
+    REQUIRE(arena.used() == 32);
+    REQUIRE(arena.scratch(32) == store + 32);
+    REQUIRE(arena.scratchPeak == 32);
+    REQUIRE(arena.take(1) == NULL);
+    REQUIRE(arena.overflows == 2);
+}
+
+TEST_CASE("Frame arena counts the frames that used the heap") {
+    static uint8_t store[FRAME_ARENA_SIZE] __attribute__((aligned(4)));
+    FrameArena arena(store, sizeof(store));
+    uint8_t *frame = arena.take(2 * FRAGMENT_SIZE);
+    FrameAssembler assembler(frame, 2 * FRAGMENT_SIZE);
+    uint8_t packet[FRAGMENT_HEADER_SIZE + FRAGMENT_SIZE];
+
+    // a frame in two fragments, then its acknowledgement
+    arena.startFrame();
+    for (int i = 0; i < 2; i++) {
+        packet[0] = 0;
+        packet[1] = 1;
+        packet[2] = i;
+        packet[3] = 2;
+        memset(packet + FRAGMENT_HEADER_SIZE, 'a' + i, FRAGMENT_SIZE);
+        REQUIRE(assembler.add(packet, sizeof(packet)) == (i == 1));
+    }
+    char *ack = (char *)arena.scratch(12);
+    BufferPrint(ack, 12).print(2 * FRAGMENT_SIZE);
+    REQUIRE(std::string(ack) == "512");
+    REQUIRE(frame[FRAGMENT_SIZE] == 'b');
+    REQUIRE(arena.endFrame() == 0);
+    REQUIRE(arena.heapFrames == 0);
+
+    // a reply too long to be held inline in a String goes to the heap
+    arena.startFrame();
+    String reply("frame 512 received, acknowledged and shown");
+    REQUIRE(reply.length() == 42);
+    REQUIRE(arena.endFrame() > 0);
+    REQUIRE(arena.heapFrames == 1);
+}
@@ -0,0 +1,122 @@
+#include <string.h>
+#include "catch.hpp"
+
+#include "frame-assembler.h"
+
+// A datagram holding fragment index of count, filled with one value
+static int fragment(uint8_t *packet, uint16_t seq, uint8_t index, uint8_t count,
+                    uint8_t fill, int size = FRAGMENT_SIZE)
+{
+    packet[0] = seq >> 8;
+    packet[1] = seq & 0xFF;
+    packet[2] = index;
+    packet[3] = count;
+    memset(packet + FRAGMENT_HEADER_SIZE, fill, size);
+    return FRAGMENT_HEADER_SIZE + size;
+}
+
+struct Assembler {
+    uint8_t frame[2 * FRAGMENT_SIZE];
+    uint8_t packet[FRAGMENT_HEADER_SIZE + FRAGMENT_SIZE];
+    FrameAssembler assembler;
+
+    Assembler() : assembler(frame, sizeof(frame)) {}
+
+    bool add(uint16_t seq, uint8_t index, uint8_t count = 2, uint8_t fill = 0) {
+        return assembler.add(packet, fragment(packet, seq, index, count, fill));
+    }
+};
+
+TEST_CASE("Frame fragments complete a frame in any order") {
+    Assembler a;
+
+    REQUIRE(!a.add(7, 1, 2, 0x22));
+    REQUIRE(a.add(7, 0, 2, 0x11));
+    REQUIRE(a.frame[0] == 0x11);
+    REQUIRE(a.frame[FRAGMENT_SIZE] == 0x22);
+    REQUIRE(a.assembler.getSequence() == 7);
+
+    REQUIRE(a.add(8, 0, 1));
+    REQUIRE(a.assembler.framesCompleted == 2);
+    REQUIRE(a.assembler.framesLost == 0);
+    REQUIRE(a.assembler.packetsLate == 0);
+}
+
+TEST_CASE("Duplicate fragments are not counted twice") {
+    Assembler a;
+
+    REQUIRE(!a.add(1, 0));
+    REQUIRE(!a.add(1, 0));
+    REQUIRE(a.add(1, 1));
+
+    // a repeat of a shown frame is late, and does not show it again
+    REQUIRE(!a.add(1, 1));
+    REQUIRE(a.assembler.framesCompleted == 1);
+    REQUIRE(a.assembler.packetsLate == 1);
+}
+
+TEST_CASE("Stale fragments are dropped and skipped frames counted as lost") {
+    Assembler a;
+
+    REQUIRE(!a.add(10, 0));
+    // frame 11 starts before 10 is complete, so 10 is lost
+    REQUIRE(!a.add(11, 0));
+    REQUIRE(a.assembler.framesLost == 1);
+    REQUIRE(!a.add(10, 1));
+    REQUIRE(a.assembler.packetsLate == 1);
+
+    REQUIRE(a.add(11, 1));
+    // 12 to 14 never arrive
+    REQUIRE(a.add(15, 0, 1));
+    REQUIRE(a.assembler.framesLost == 4);
+    REQUIRE(a.assembler.framesCompleted == 2);
+}
+
+TEST_CASE("Frame sequence numbers wrap at 65535") {
+    Assembler a;
+
+    REQUIRE(a.add(65534, 0, 1));
+    REQUIRE(a.add(65535, 0, 1));
+    REQUIRE(a.add(0, 0, 1));
+    REQUIRE(a.add(2, 0, 1));
+    REQUIRE(a.assembler.framesLost == 1);
+
+    // from before the wrap, so late rather than a restart
+    REQUIRE(!a.add(65535, 0, 1));
+    REQUIRE(a.assembler.packetsLate == 1);
+    REQUIRE(a.assembler.getSequence() == 2);
+}
+
+TEST_CASE("A sender restart is followed once outside the resync window") {
+    Assembler a;
+
+    REQUIRE(a.add(1000, 0, 1));
+
+    // just inside the window, still taken as late
+    REQUIRE(!a.add(1000 - RESYNC_WINDOW, 0, 1));
+    REQUIRE(a.assembler.packetsLate == 1);
+
+    REQUIRE(a.add(0, 0, 1));
+    REQUIRE(a.assembler.getSequence() == 0);
+    REQUIRE(a.add(1, 0, 1));
+    REQUIRE(a.assembler.framesCompleted == 3);
+    REQUIRE(a.assembler.framesLost == 0);
+}
+
+TEST_CASE("Malformed fragments are counted as invalid") {
+    Assembler a;
+
+    REQUIRE(!a.assembler.add(a.packet, FRAGMENT_HEADER_SIZE));
+    REQUIRE(!a.add(1, 0, 0));
+    REQUIRE(!a.add(1, 2, 2));
+    REQUIRE(!a.add(1, 0, MAX_FRAGMENTS + 1));
+    // a third fragment would not fit in the frame
+    REQUIRE(!a.add(1, 2, 3));
+    REQUIRE(a.assembler.packetsInvalid == 5);
+
+    // a fragment count that disagrees with the frame in progress
+    REQUIRE(!a.add(2, 0, 2));
+    REQUIRE(!a.add(2, 1, 3));
+    REQUIRE(a.assembler.packetsInvalid == 6);
+    REQUIRE(a.assembler.framesCompleted == 0);
+}
@@ -0,0 +1,96 @@
+#include "catch.hpp"
+#include "spark_wiring_poller.h"
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+
+class FakeSocket : public Pollable {
+public:
+    int fds[2];
+    int received;
+    bool watching;
+
+    FakeSocket() : received(0), watching(true) {
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    }
+    ~FakeSocket() {
+        close(fds[0]);
+        close(fds[1]);
+    }
+    void send(const char *data) {
+        write(fds[1], data, strlen(data));
+    }
+    bool polled() { return _poller != NULL; }
+
+    long pollSocket() { return watching ? fds[0] : -1; }
+    void pollReady() {
+        char buffer[64];
+        received += read(fds[0], buffer, sizeof(buffer));
+    }
+};
+
+SCENARIO("Only readable sockets are dispatched", "[poller]") {
+    SocketPoller poller;
+    FakeSocket a, b, c;
+
+    REQUIRE(poller.add(a));
+    REQUIRE(poller.add(b));
+    REQUIRE(poller.add(c));
+
+    REQUIRE(poller.poll(0) == 0);
+
+    b.send("hello");
+    c.send("hi");
+    REQUIRE(poller.poll(0) == 2);
+    CHECK(a.received == 0);
+    CHECK(b.received == 5);
+    CHECK(c.received == 2);
+
+    REQUIRE(poller.poll(0) == 0);
+}
+
+SCENARIO("Sockets that are not watching are skipped", "[poller]") {
+    SocketPoller poller;
+    FakeSocket a;
+
+    poller.add(a);
+    a.watching = false;
+    a.send("x");
+    REQUIRE(poller.poll(0) == 0);
+    CHECK(a.received == 0);
+
+    a.watching = true;
+    REQUIRE(poller.poll(0) == 1);
+    CHECK(a.received == 1);
+}
+
+SCENARIO("Registration is limited and follows the object", "[poller]") {
+    SocketPoller poller, other;
+    FakeSocket sockets[POLLER_MAX_SOCKETS + 1];
+
+    for (int i = 0; i < POLLER_MAX_SOCKETS; i++)
+        REQUIRE(poller.add(sockets[i]));
+    REQUIRE_FALSE(poller.add(sockets[POLLER_MAX_SOCKETS]));
+
+    // already registered here, not movable to another poller
+    REQUIRE(poller.add(sockets[0]));
+    REQUIRE_FALSE(other.add(sockets[0]));
+
+    poller.remove(sockets[0]);
+    CHECK_FALSE(sockets[0].polled());
+    REQUIRE(poller.add(sockets[POLLER_MAX_SOCKETS]));
+}
+
+SCENARIO("Destroyed objects leave the poller", "[poller]") {
+    SocketPoller poller;
+    FakeSocket kept;
+    poller.add(kept);
+    {
+        FakeSocket gone;
+        poller.add(gone);
+        gone.send("x");
+    }
+    kept.send("abc");
+    REQUIRE(poller.poll(0) == 1);
+    CHECK(kept.received == 3);
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include "catch.hpp"
+
+#include "pool_alloc.h"
+
+static const size_t blockSizes[POOL_CLASSES] = POOL_BLOCK_SIZES;
+static const size_t blockCounts[POOL_CLASSES] = POOL_BLOCK_COUNTS;
+
+static pool_class_stats_t poolClass(int c)
+{
+    heap_stats_t stats;
+    pool_stats(&stats);
+    return stats.pools[c];
+}
+
+TEST_CASE("Pool blocks come from the smallest class that fits") {
+    for (int c = 0; c < POOL_CLASSES; c++) {
+        pool_class_stats_t before = poolClass(c);
+        uint32_t allocs = pool_alloc_count();
+        void *p = pool_malloc(blockSizes[c]);
+
+        REQUIRE(pool_alloc_count() == allocs + 1);
+        REQUIRE(pool_block_size(p) == blockSizes[c]);
+        REQUIRE(poolClass(c).in_use == before.in_use + 1);
+        REQUIRE(poolClass(c).allocs == before.allocs + 1);
+        REQUIRE(poolClass(c).peak >= poolClass(c).in_use);
+
+        pool_free(p);
+        REQUIRE(poolClass(c).in_use == before.in_use);
+    }
+
+    void *big = pool_malloc(blockSizes[POOL_CLASSES - 1] + 1);
+    REQUIRE(big != NULL);
+    REQUIRE(pool_block_size(big) == 0);
+    pool_free(big);
+}
+
+TEST_CASE("A full pool class spills into larger classes and then the heap") {
+    const int c = POOL_CLASSES - 1;
+    size_t count = blockCounts[c] - poolClass(c).in_use;
+    void *blocks[64];
+    REQUIRE(count < 64);
+
+    for (size_t i = 0; i < count; i++) {
+        blocks[i] = pool_malloc(blockSizes[c]);
+        REQUIRE(pool_block_size(blocks[i]) == blockSizes[c]);
+    }
+    REQUIRE(poolClass(c).in_use == blockCounts[c]);
+
+    uint32_t overflows = poolClass(c).overflows;
+    void *heap = pool_malloc(blockSizes[c]);
+    REQUIRE(heap != NULL);
+    REQUIRE(pool_block_size(heap) == 0);
+    REQUIRE(poolClass(c).overflows == overflows + 1);
+
+    // freed blocks are handed out again, most recent first
+    pool_free(blocks[0]);
+    REQUIRE(pool_malloc(blockSizes[c]) == blocks[0]);
+
+    pool_free(heap);
+    for (size_t i = 0; i < count; i++) {
+        pool_free(blocks[i]);
+    }
+    REQUIRE(poolClass(c).in_use == blockCounts[c] - count);
+}
+
+TEST_CASE("Pool realloc keeps a block while the data fits") {
+    char *p = (char *)pool_malloc(5);
+    memcpy(p, "abcd", 5);
+
+    REQUIRE(pool_realloc(p, blockSizes[0]) == p);
+
+    char *moved = (char *)pool_realloc(p, blockSizes[0] + 1);
+    REQUIRE(pool_block_size(moved) == blockSizes[1]);
+    REQUIRE(std::string(moved) == "abcd");
+
+    moved = (char *)pool_realloc(moved, 1000);
+    REQUIRE(pool_block_size(moved) == 0);
+    REQUIRE(std::string(moved) == "abcd");
+    pool_free(moved);
+
+    REQUIRE(pool_block_size(pool_realloc(NULL, 1)) == blockSizes[0]);
+}
+
+TEST_CASE("Pool calloc clears and checks for overflow") {
+    heap_stats_t stats;
+    pool_stats(&stats);
+    uint32_t failed = stats.failed_allocs;
+
+    char *p = (char *)pool_calloc(3, 10);
+    for (int i = 0; i < 30; i++) {
+        REQUIRE(p[i] == 0);
+    }
+    pool_free(p);
+
+    REQUIRE(pool_calloc((size_t)-1 / 2, 4) == NULL);
+    pool_stats(&stats);
+    REQUIRE(stats.failed_allocs == failed + 1);
+}
+
+// Benchmarks, run with: obj/runner [benchmark]
+
+TEST_CASE("Small allocation churn", "[.][benchmark]") {
+    const int rounds = 200000;
+    void *live[8] = { 0 };
+
+    for (int pooled = 0; pooled < 2; pooled++) {
+        clock_t start = clock();
+        for (int r = 0; r < rounds; r++) {
+            int slot = r % 8;
+            size_t size = 8 + (r * 7) % 56;
+            if (pooled) {
+                pool_free(live[slot]);
+                live[slot] = pool_malloc(size);
+            } else {
+                free(live[slot]);
+                live[slot] = malloc(size);
+            }
+        }
+        for (int i = 0; i < 8; i++) {
+            pooled ? pool_free(live[i]) : free(live[i]);
+            live[i] = NULL;
+        }
+        double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / rounds;
+        std::cout << (pooled ? "pool_malloc/pool_free: " : "malloc/free: ") << ns << " ns per pair" << std::endl;
+    }
+}
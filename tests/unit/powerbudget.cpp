@@ -0,0 +1,105 @@
+#include "catch.hpp"
+#include "power-budget.h"
+#include "command-batch.h"
+
+#include <string.h>
+
+static const uint32_t palette[] = { 0x000000, 0xFFFFFF, 0xFF0000, 0x808080 };
+
+SCENARIO("A dark frame draws only idle current", "[powerbudget]") {
+    uint8_t frame[512] = { 0 };
+
+    REQUIRE(estimateCurrent(frame, palette, 512) == 512 * LED_IDLE_MA);
+}
+
+SCENARIO("Current follows the channel values", "[powerbudget]") {
+    uint8_t frame[10] = { 1, 1, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+    // five white pixels at three channels, five red at one
+    REQUIRE(estimateCurrent(frame, palette, 10) == 20 * LED_CHANNEL_MA + 10 * LED_IDLE_MA);
+}
+
+SCENARIO("Frames within the budget are not scaled", "[powerbudget]") {
+    REQUIRE(budgetScale(1000, 1000, 512) == 255);
+    REQUIRE(budgetScale(600, 2000, 512) == 255);
+}
+
+SCENARIO("Frames over the budget scale to fit it", "[powerbudget]") {
+    uint8_t frame[512];
+    for (int i = 0; i < 512; i++)
+        frame[i] = 1;
+
+    uint32_t full = estimateCurrent(frame, palette, 512);
+    REQUIRE(full == 512 * (3 * LED_CHANNEL_MA + LED_IDLE_MA));
+
+    uint32_t budget = 4000;
+    uint8_t scale = budgetScale(full, budget, 512);
+    REQUIRE(scale < 255);
+
+    // white scaled the way the strip does it
+    uint32_t level = (255 * (scale + 1)) >> 8;
+    uint32_t scaled[] = { level << 16 | level << 8 | level };
+    uint8_t zero[512] = { 0 };
+    CHECK(estimateCurrent(zero, scaled, 512) <= budget);
+    CHECK(estimateCurrent(zero, scaled, 512) > budget * 9 / 10);
+}
+
+SCENARIO("A budget below idle current blanks the frame", "[powerbudget]") {
+    REQUIRE(budgetScale(2000, 400, 512) == 0);
+}
+
+SCENARIO("Pixel buffers are estimated like palette frames", "[powerbudget]") {
+    uint8_t indices[512];
+    uint8_t pixels[512 * 3];
+
+    for (int i = 0; i < 512; i++) {
+        indices[i] = i % 4;
+        uint32_t c = palette[i % 4];
+        pixels[i * 3] = c >> 16;
+        pixels[i * 3 + 1] = c >> 8;
+        pixels[i * 3 + 2] = c;
+    }
+
+    REQUIRE(estimatePixelCurrent(pixels, 512) == estimateCurrent(indices, palette, 512));
+}
+
+SCENARIO("A full-white command batch is held to the budget", "[powerbudget]") {
+    // OP_CLEAR to white then OP_PRESENT, as a client would send it
+    const uint8_t batch[] = { OP_CLEAR, 0xFF, 0xFF, 0xFF, OP_PRESENT };
+    REQUIRE(checkCommands(batch, sizeof(batch)) == 2);
+
+    // what OP_CLEAR leaves in the strip's pixel buffer
+    uint8_t pixels[512 * 3];
+    memset(pixels, batch[1], sizeof(pixels));
+
+    GIVEN("The cube's default budget") {
+        uint32_t budget = 6000;
+        uint32_t asked = limitPixels(pixels, 512, budget);
+
+        THEN("The batch asks for far more") {
+            CHECK(asked == 512 * (3 * LED_CHANNEL_MA + LED_IDLE_MA));
+        }
+
+        THEN("What is shown stays within it, and close to it") {
+            uint32_t shown = estimatePixelCurrent(pixels, 512);
+            CHECK(shown <= budget);
+            CHECK(shown > budget * 9 / 10);
+        }
+
+        THEN("Showing again changes nothing") {
+            uint8_t before[512 * 3];
+            memcpy(before, pixels, sizeof(before));
+            limitPixels(pixels, 512, budget);
+            CHECK(memcmp(before, pixels, sizeof(before)) == 0);
+        }
+    }
+}
+
+SCENARIO("Pixels within the budget are left alone", "[powerbudget]") {
+    uint8_t pixels[512 * 3] = { 0 };
+    pixels[0] = 0xFF;
+
+    uint32_t asked = limitPixels(pixels, 512, 6000);
+    CHECK(asked == LED_CHANNEL_MA + 512 * LED_IDLE_MA);
+    CHECK(pixels[0] == 0xFF);
+}
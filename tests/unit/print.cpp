@@ -0,0 +1,161 @@
+#include <iostream>
+#include <limits.h>
+#include <time.h>
+#include <string>
+#include "catch.hpp"
+
+#include "spark_wiring_print.h"
+
+// Keeps what was printed, and counts the writes it arrived in
+class CapturePrint : public Print
+{
+public:
+    std::string text;
+    int writes;
+
+    CapturePrint() : writes(0) {}
+
+    size_t write(uint8_t c) {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) {
+        text.append((const char *)buffer, size);
+        writes++;
+        return size;
+    }
+};
+
+TEST_CASE("Print writes numbers in one piece") {
+    CapturePrint out;
+
+    REQUIRE(out.print(-1234567L) == 8);
+    REQUIRE(out.text == "-1234567");
+    REQUIRE(out.writes == 1);
+
+    out.text.clear();
+    out.print(LONG_MIN);
+    REQUIRE(out.text == std::to_string(LONG_MIN));
+
+    out.text.clear();
+    out.print(0xBEEFUL, HEX);
+    out.print(5, BIN);
+    out.print(0, DEC);
+    REQUIRE(out.text == "BEEF1010");
+}
+
+TEST_CASE("Print writes a line ending in one piece") {
+    CapturePrint out;
+
+    REQUIRE(out.println() == 2);
+    REQUIRE(out.text == "\r\n");
+    REQUIRE(out.writes == 1);
+}
+
+TEST_CASE("Print prints floats as before") {
+    CapturePrint out;
+
+    out.print(1.999, 2);
+    out.print(' ');
+    out.print(-0.5, 1);
+    out.print(' ');
+    out.print(3.0, 0);
+    out.print(' ');
+    out.print(1e10);
+    REQUIRE(out.text == "2.00 -0.5 3 ovf");
+}
+
+TEST_CASE("Print printf formats into one write") {
+    CapturePrint out;
+
+    size_t n = out.printf("%c%lu %s\r\n", '~', 123456789UL, "hello");
+    REQUIRE(out.text == "~123456789 hello\r\n");
+    REQUIRE(n == out.text.length());
+    REQUIRE(out.writes == 1);
+}
+
+TEST_CASE("Print printf conversions") {
+    CapturePrint out;
+
+    out.printf("%d|%i|%u|%x|%X|%o|%%|%c", -42, 7, 3000000000U, 0xbeef, 0xbeef, 8, 'z');
+    REQUIRE(out.text == "-42|7|3000000000|beef|BEEF|10|%|z");
+
+    out.text.clear();
+    out.printf("%ld|%lx|%d", LONG_MIN, 0xFFFFFFFFUL, INT_MIN);
+    REQUIRE(out.text == std::to_string(LONG_MIN) + "|ffffffff|-2147483648");
+
+    out.text.clear();
+    out.printf("%.2f|%f|%.0f|%+.1f|%f", 3.14159, -2.5, 2.5, 1.25, 1.0 / 0.0);
+    REQUIRE(out.text == "3.14|-2.500000|3|+1.3|inf");
+}
+
+TEST_CASE("Print printf width, flags and precision") {
+    CapturePrint out;
+
+    out.printf("[%5d][%-5d][%05d][%+d][%02x:%02x]", 42, 42, -42, 42, 0xa, 0xbc);
+    REQUIRE(out.text == "[   42][42   ][-0042][+42][0a:bc]");
+
+    out.text.clear();
+    out.printf("[%*s][%-*s][%.3s][%.*s]", 4, "ab", 4, "ab", "abcdef", 2, "xyz");
+    REQUIRE(out.text == "[  ab][ab  ][abc][xy]");
+}
+
+TEST_CASE("Print printf splits long output into buffer sized writes") {
+    CapturePrint out;
+    std::string longText(150, 'x');
+
+    size_t n = out.printf("<%s>", longText.c_str());
+    REQUIRE(out.text == "<" + longText + ">");
+    REQUIRE(n == 152);
+    REQUIRE(out.writes == 3);
+}
+
+TEST_CASE("BufferPrint fills a char array and stays terminated") {
+    char buf[8];
+    BufferPrint out(buf, sizeof(buf));
+
+    REQUIRE(out.getLength() == 0);
+    REQUIRE(buf[0] == 0);
+
+    out.printf("%d.%d", 10, 2);
+    REQUIRE(std::string(buf) == "10.2");
+
+    REQUIRE(out.print("34567") == 3);
+    REQUIRE(std::string(buf) == "10.2345");
+    REQUIRE(out.getLength() == 7);
+}
+
+// Benchmarks, run with: obj/runner [benchmark]
+
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t c) { return 1; }
+    size_t write(const uint8_t *buffer, size_t size) { return size; }
+};
+
+TEST_CASE("Print integers", "[.][benchmark]") {
+    NullPrint out;
+    const long rounds = 2000000;
+    size_t n = 0;
+    clock_t start = clock();
+    for (long i = 0; i < rounds; i++) {
+        n += out.print(i * 2654435761L % 100000000L - 50000000L);
+    }
+    double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / rounds;
+    std::cout << "print(long): " << ns << " ns per number" << std::endl;
+    REQUIRE(n > 0);
+}
+
+TEST_CASE("Print formatted message", "[.][benchmark]") {
+    NullPrint out;
+    const long rounds = 1000000;
+    size_t n = 0;
+    clock_t start = clock();
+    for (long i = 0; i < rounds; i++) {
+        n += out.printf("%c%lu %s\r\n", '~', (unsigned long)i * 7919, "frame shown");
+    }
+    double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / rounds;
+    std::cout << "printf(): " << ns << " ns per message" << std::endl;
+    REQUIRE(n > 0);
+}
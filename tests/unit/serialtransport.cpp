@@ -0,0 +1,117 @@
+#include <string>
+#include <vector>
+#include "catch.hpp"
+
+#include "spark_wiring_stream.h"
+#include "serial-transport.h"
+
+// Hands out its input in chunks of a given size and keeps what is written
+class LinkStream : public Stream
+{
+public:
+    std::string input;
+    std::string output;
+    size_t position;
+    size_t chunk;
+
+    LinkStream(size_t chunk) : position(0), chunk(chunk) {}
+
+    int available() { return input.length() - position; }
+    int read() { return position < input.length() ? (uint8_t)input[position++] : -1; }
+    int peek() { return position < input.length() ? (uint8_t)input[position] : -1; }
+    void flush() {}
+    size_t write(uint8_t c) { output += (char)c; return 1; }
+    size_t write(const uint8_t *buffer, size_t size) {
+        output.append((const char *)buffer, size);
+        return size;
+    }
+
+    size_t peekBuffer(const uint8_t *&buffer) {
+        size_t n = input.length() - position;
+        buffer = (const uint8_t *)input.data() + position;
+        return n < chunk ? n : chunk;
+    }
+    void consume(size_t length) { position += length; }
+};
+
+static std::vector<std::string> received;
+
+static void collect(uint8_t *data, int length)
+{
+    received.push_back(std::string((const char *)data, length));
+}
+
+// A payload framed the way a host sends it
+static std::string frame(const std::string &payload)
+{
+    std::string data = payload;
+    uint16_t crc = crc16((const uint8_t *)payload.data(), payload.length());
+    data += (char)(crc >> 8);
+    data += (char)(crc & 0xFF);
+
+    std::vector<uint8_t> encoded(COBS_ENCODED_SIZE(data.length()));
+    size_t n = cobsEncode((const uint8_t *)data.data(), data.length(), &encoded[0]);
+    return std::string((const char *)&encoded[0], n) + '\0';
+}
+
+TEST_CASE("CRC-16 and COBS match their reference values") {
+    REQUIRE(crc16((const uint8_t *)"123456789", 9) == 0x29B1);
+
+    const uint8_t data[] = { 0x11, 0x22, 0x00, 0x33 };
+    uint8_t encoded[8];
+    REQUIRE(cobsEncode(data, 4, encoded) == 5);
+    REQUIRE(std::string((const char *)encoded, 5) == std::string("\x03\x11\x22\x02\x33", 5));
+
+    std::string zeros(3, '\0');
+    REQUIRE(cobsEncode((const uint8_t *)zeros.data(), 3, encoded) == 4);
+    REQUIRE(std::string((const char *)encoded, 4) == "\x01\x01\x01\x01");
+}
+
+TEST_CASE("Serial transport delivers frames whatever the chunk size") {
+    std::string pixels(512, '\0');
+    for (size_t i = 0; i < pixels.length(); i++) {
+        pixels[i] = (i * 7) % 256;
+    }
+    std::string runs = std::string(300, 'x') + std::string(2, '\0') + std::string(260, 'y');
+    runs.resize(512);
+
+    for (size_t chunk = 1; chunk <= 70; chunk += 23) {
+        LinkStream link(chunk);
+        SerialTransport transport(link, collect);
+        received.clear();
+
+        link.input = frame(pixels) + frame("ab") + frame(runs);
+        for (int i = 0; i < 3; i++) {
+            transport.poll();
+        }
+
+        REQUIRE(received.size() == 3);
+        REQUIRE(received[0] == pixels);
+        REQUIRE(received[1] == "ab");
+        REQUIRE(received[2] == runs);
+        REQUIRE(link.output == frame("512") + frame("2") + frame("512"));
+        REQUIRE(transport.framesInvalid == 0);
+    }
+}
+
+TEST_CASE("Serial transport drops damaged frames and resynchronizes") {
+    LinkStream link(16);
+    SerialTransport transport(link, collect);
+    received.clear();
+
+    std::string damaged = frame("hello");
+    damaged[3] ^= 0x01;
+    std::string tooLong = frame(std::string(SERIAL_FRAME_SIZE + 1, 'z'));
+
+    // text written to the same port, padding, a damaged, an oversized and a good frame
+    link.input = std::string("Handshake\r\n") + '\0' + '\0' + damaged + tooLong + frame("ok");
+    for (int i = 0; i < 5; i++) {
+        transport.poll();
+    }
+
+    REQUIRE(received.size() == 1);
+    REQUIRE(received[0] == "ok");
+    REQUIRE(transport.framesReceived == 1);
+    REQUIRE(transport.framesInvalid == 2);
+    REQUIRE(transport.framesTooLong == 1);
+}
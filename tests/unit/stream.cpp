@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <time.h>
+#include "catch.hpp"
+
+#include "spark_wiring.h"
+
+// Every call moves the clock on a millisecond, so timeouts run out quickly
+system_tick_t millis(void)
+{
+    static system_tick_t now;
+    return now++;
+}
+
+// Reads from a string a byte at a time, through the default bulk hooks
+class ByteStream : public Stream
+{
+public:
+    std::string data;
+    size_t position;
+
+    ByteStream(const std::string &data) : data(data), position(0) {}
+
+    using Stream::parseInt;
+
+    int available() { return data.length() - position; }
+    int read() { return position < data.length() ? (uint8_t)data[position++] : -1; }
+    int peek() { return position < data.length() ? (uint8_t)data[position] : -1; }
+    void flush() {}
+    size_t write(uint8_t c) { return 1; }
+};
+
+// Hands out its string in chunks of a given size, like a receive buffer
+class ChunkStream : public ByteStream
+{
+public:
+    size_t chunk;
+
+    ChunkStream(const std::string &data, size_t chunk) : ByteStream(data), chunk(chunk) {}
+
+    size_t peekBuffer(const uint8_t *&buffer) {
+        size_t n = data.length() - position;
+        buffer = (const uint8_t *)data.data() + position;
+        return n < chunk ? n : chunk;
+    }
+    void consume(size_t length) { position += length; }
+};
+
+static std::string rest(ByteStream &stream)
+{
+    return stream.data.substr(stream.position);
+}
+
+TEST_CASE("Stream readers agree whatever the chunk size") {
+    const char *text = "GET / HTTP/1.1\r\nHost: x\r\n\r\nvalue=-1,234;pi 3.25 end";
+
+    for (size_t chunk = 0; chunk <= 8; chunk++) {
+        ByteStream bytes(text);
+        ChunkStream chunks(text, chunk ? chunk : 1000);
+        ByteStream *streams[] = { &bytes, &chunks };
+
+        for (ByteStream *stream : streams) {
+            char buf[32];
+            size_t n = stream->readBytesUntil('\n', buf, sizeof(buf));
+            REQUIRE(std::string(buf, n) == "GET / HTTP/1.1\r");
+
+            n = stream->readBytes(buf, 4);
+            REQUIRE(std::string(buf, n) == "Host");
+
+            REQUIRE(stream->find((char *)"\r\n\r\n"));
+            REQUIRE(rest(*stream) == "value=-1,234;pi 3.25 end");
+
+            REQUIRE(stream->parseInt() == -1);
+            REQUIRE(rest(*stream) == ",234;pi 3.25 end");
+
+            REQUIRE(stream->parseFloat() == 234.0f);
+            REQUIRE(stream->parseFloat() == 3.25f);
+            REQUIRE(rest(*stream) == " end");
+
+            REQUIRE(stream->readStringUntil('n') == " e");
+            REQUIRE(stream->readString() == "d");
+            REQUIRE(stream->readBytes(buf, sizeof(buf)) == 0);
+        }
+    }
+}
+
+TEST_CASE("Stream readBytesUntil stops at the buffer size") {
+    ChunkStream stream("abcdef\nxyz", 4);
+    char buf[6];
+
+    REQUIRE(stream.readBytesUntil('\n', buf, sizeof(buf)) == 6);
+    REQUIRE(rest(stream) == "\nxyz");
+    REQUIRE(stream.readBytesUntil('\n', buf, sizeof(buf)) == 0);
+    REQUIRE(rest(stream) == "xyz");
+}
+
+TEST_CASE("Stream findUntil consumes no further than the match") {
+    ChunkStream stream("key: 1\r\nnext: 2\r\n", 100);
+
+    REQUIRE(!stream.findUntil((char *)"next", (char *)"\r\n"));
+    REQUIRE(rest(stream) == "next: 2\r\n");
+    REQUIRE(stream.findUntil((char *)"next", (char *)"\r\n"));
+    REQUIRE(rest(stream) == ": 2\r\n");
+    REQUIRE(stream.parseInt() == 2);
+    REQUIRE(!stream.find((char *)"missing"));
+}
+
+TEST_CASE("Stream parseInt skips a given character") {
+    ChunkStream stream("x 1,234,567 y", 3);
+
+    REQUIRE(stream.parseInt(',') == 1234567);
+    REQUIRE(rest(stream) == " y");
+    REQUIRE(stream.parseInt() == 0);
+}
+
+// Benchmarks, run with: obj/runner [benchmark]
+
+TEST_CASE("Stream line reading", "[.][benchmark]") {
+    std::string text;
+    for (int i = 0; i < 1000; i++) {
+        text += "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n";
+    }
+    const int rounds = 50;
+
+    for (int bulk = 0; bulk < 2; bulk++) {
+        size_t total = 0;
+        clock_t start = clock();
+        for (int r = 0; r < rounds; r++) {
+            ByteStream bytes(text);
+            ChunkStream chunks(text, 128);
+            Stream &stream = bulk ? (Stream &)chunks : (Stream &)bytes;
+            char line[64];
+            size_t n;
+            while ((n = stream.readBytesUntil('\n', line, sizeof(line))) > 0) {
+                total += n;
+            }
+        }
+        double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / (rounds * text.length());
+        std::cout << (bulk ? "readBytesUntil, chunks: " : "readBytesUntil, bytes: ")
+                  << ns << " ns per byte" << std::endl;
+        REQUIRE(total > 0);
+    }
+}
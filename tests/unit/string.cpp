@@ -1,6 +1,16 @@
 
 #include <iostream>
+#include <string>
 #include <limits.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+#define heapInfo mallinfo2
+#else
+#define heapInfo mallinfo
+#endif
+#endif
 #include "catch.hpp"
 
 #include "spark_wiring_string.h"
@@ -42,6 +52,134 @@ TEST_CASE("Can print UINT_MAX in binary") {
     REQUIRE(String(UINT_MAX, BIN)=="11111111111111111111111111111111");
 }
 
+TEST_CASE("Appending one char at a time builds the whole string") {
+    String s;
+    for (int i = 0; i < 512; i++) {
+        s += (char)('a' + i % 26);
+    }
+    REQUIRE(s.length() == 512);
+    for (int i = 0; i < 512; i++) {
+        REQUIRE(s[i] == (char)('a' + i % 26));
+    }
+}
+
+static bool heldInside(const String& s) {
+    const char* self = (const char*)&s;
+    return s.c_str() >= self && s.c_str() < self + sizeof(s);
+}
+
+TEST_CASE("Short strings are held inside the String") {
+    String s("ack 512");
+    REQUIRE(heldInside(s));
+
+    String n(4294967295UL);
+    REQUIRE(n == "4294967295");
+    REQUIRE(heldInside(n));
+
+    s += " and then some more";
+    REQUIRE_FALSE(heldInside(s));
+}
+
+TEST_CASE("Strings move between the inline buffer and the heap") {
+    String s("short");
+    s += " but now long enough to need the heap";
+    REQUIRE(s == "short but now long enough to need the heap");
+
+    String copy(s);
+    REQUIRE(copy == s);
+    REQUIRE(copy.length() == s.length());
+
+    String small("tiny");
+    String moved(small + "!");
+    REQUIRE(moved == "tiny!");
+
+    s = "ok";
+    REQUIRE(s == "ok");
+    REQUIRE(s.length() == 2);
+}
+
+TEST_CASE("A String can be appended to itself") {
+    String s("abc");
+    s += s;
+    REQUIRE(s == "abcabc");
+    for (int i = 0; i < 4; i++) {
+        s += s;
+    }
+    REQUIRE(s.length() == 96);
+    REQUIRE(s.endsWith("abcabc"));
+}
+
+TEST_CASE("An empty String is valid") {
+    String s;
+    REQUIRE(s);
+    REQUIRE(s.length() == 0);
+    REQUIRE(s == "");
+}
+
+TEST_CASE("Can convert longs in every radix") {
+    REQUIRE(String(LONG_MIN, DEC)==String(std::to_string(LONG_MIN).c_str()));
+    REQUIRE(String(-1234567890L, DEC)=="-1234567890");
+    REQUIRE(String(1234567890UL, DEC)=="1234567890");
+    REQUIRE(String(0xDEADBEEFUL, HEX)=="deadbeef");
+    REQUIRE(String(35L, (unsigned char)36)=="Z");
+    REQUIRE(String(100L, (unsigned char)7)=="202");
+    REQUIRE(String(7, OCT)=="7");
+    REQUIRE(String(0UL, DEC)=="0");
+}
+
+// Benchmarks, run with: obj/runner [benchmark]
+
+TEST_CASE("String append loop", "[.][benchmark]") {
+    const int rounds = 2000;
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) {
+        String data;
+        for (int i = 0; i < 512; i++) {
+            data += (char)i;
+        }
+        REQUIRE(data.length() == 512);
+    }
+    double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / (rounds * 512);
+    std::cout << "String += char: " << ns << " ns per append" << std::endl;
+}
+
+TEST_CASE("String header parsing churn", "[.][benchmark]") {
+    // analyzeRequest(): each header line is built a byte at a time, kept
+    // briefly and replaced, while a few values live on
+    const char* request =
+        "GET / HTTP/1.1\r\n"
+        "Host: 192.168.1.20:2525\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Origin: http://localhost:8000\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    const int rounds = 20000;
+#ifdef __GLIBC__
+    auto before = heapInfo();
+#endif
+    String kept[8];
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++) {
+        String line;
+        for (const char* p = request; *p; p++) {
+            line += *p;
+            if (*p == '\n') {
+                kept[r % 8] = line.substring(0, line.length() - 2);
+                line = "";
+            }
+        }
+    }
+    double us = (double)(clock() - start) / CLOCKS_PER_SEC * 1e6 / rounds;
+    std::cout << "Header parse: " << us << " us per request" << std::endl;
+#ifdef __GLIBC__
+    auto after = heapInfo();
+    std::cout << "Heap after parsing: " << (long)(after.uordblks - before.uordblks) << " more bytes in use, "
+              << (long)(after.fordblks - before.fordblks) << " more bytes free, "
+              << (long)(after.ordblks - before.ordblks) << " more free chunks" << std::endl;
+#endif
+}
+
 // add String printing function 
 namespace Catch {
 
@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include "spark_wiring_string.h"
+#include "spark_wiring_stringview.h"
+
+TEST_CASE("StringView compares without a terminator") {
+    const char buf[] = { 'U', 'p', 'g', 'r', 'a', 'd', 'e', 'X' };
+    StringView view(buf, 7);
+
+    REQUIRE(view.length() == 7);
+    REQUIRE(view == "Upgrade");
+    REQUIRE(view != "UpgradeX");
+    REQUIRE(view.equalsIgnoreCase("UPGRADE"));
+    REQUIRE(view.startsWith("Upg"));
+    REQUIRE(!view.startsWith("upg"));
+    REQUIRE(view.startsWithIgnoreCase("upg"));
+    REQUIRE(view.endsWith("ade"));
+    REQUIRE(!view.startsWith("UpgradeX"));
+    REQUIRE(view[7] == 0);
+}
+
+TEST_CASE("StringView trims and splits in place") {
+    char line[] = "  Host:   example.com:80 \r";
+    StringView header = StringView(line).trim();
+
+    REQUIRE(header == "Host:   example.com:80");
+
+    StringView name = header.split(':');
+    REQUIRE(name == "Host");
+    REQUIRE(header.trim() == "example.com:80");
+    REQUIRE(header.trim().split(':') == "example.com");
+
+    StringView last = header.split('#');
+    REQUIRE(last == "   example.com:80");
+    REQUIRE(header.length() == 0);
+    REQUIRE(header.split(':').length() == 0);
+}
+
+TEST_CASE("StringView finds characters and substrings") {
+    StringView view("a=1;b=22");
+
+    REQUIRE(view.indexOf(';') == 3);
+    REQUIRE(view.indexOf('=', 2) == 5);
+    REQUIRE(view.indexOf('x') == -1);
+    REQUIRE(view.indexOf('a', 100) == -1);
+    REQUIRE(view.substring(4) == "b=22");
+    REQUIRE(view.substring(6, 4) == "b=");
+    REQUIRE(view.substring(100).length() == 0);
+}
+
+TEST_CASE("StringView converts to integers") {
+    const char digits[] = { '4', '2', '7' };
+
+    REQUIRE(StringView(digits, 2).toInt() == 42);
+    REQUIRE(StringView(" -13ms").toInt() == -13);
+    REQUIRE(StringView("+8").toInt() == 8);
+    REQUIRE(StringView("x").toInt() == 0);
+    REQUIRE(StringView().toInt() == 0);
+}
+
+TEST_CASE("StringView copies into a terminated buffer") {
+    char buf[4];
+
+    StringView("abcdef").toCharArray(buf, sizeof(buf));
+    REQUIRE(StringView(buf) == "abc");
+
+    StringView("ab").toCharArray(buf, sizeof(buf));
+    REQUIRE(StringView(buf) == "ab");
+}
+
+TEST_CASE("StringView works with String") {
+    String s("Sec-WebSocket-Key");
+    StringView view(s);
+
+    REQUIRE(view.data() == s.c_str());
+    REQUIRE(view.startsWithIgnoreCase("sec-"));
+
+    String copy(view.substring(4, 13));
+    REQUIRE(copy == "WebSocket");
+
+    copy = StringView("Key: value").split(':');
+    REQUIRE(copy == "Key");
+
+    copy += StringView("-suffix-", 7);
+    REQUIRE(copy == "Key-suffix");
+
+    REQUIRE(StringView((const char *)NULL).length() == 0);
+    REQUIRE(StringView(String((const char *)NULL)).length() == 0);
+}
@@ -0,0 +1,55 @@
+#include "catch.hpp"
+#include "bit-transpose.h"
+
+#include <stdlib.h>
+
+// straightforward reference: test every bit of every strip
+static void naiveSlots(uint16_t words[8], const uint8_t column[MAX_STRIPS],
+        const uint16_t* pinMasks, uint8_t count) {
+    for (int b = 0; b < 8; b++) {
+        words[b] = 0;
+        for (int s = 0; s < count; s++) {
+            if (column[s] & (0x80 >> b))
+                words[b] |= pinMasks[s];
+        }
+    }
+}
+
+SCENARIO("Bit transposition matches the per-bit reference", "[transpose]") {
+    // scattered pins, as on the Spark Core's GPIOB: D0, D1, D2, D3, D4, A6, A7
+    const uint16_t pinMasks[MAX_STRIPS] = { 1<<7, 1<<6, 1<<5, 1<<4, 1<<3, 1<<0, 1<<1, 1<<15 };
+    srand(3);
+
+    for (uint8_t count = 1; count <= MAX_STRIPS; count++) {
+        uint16_t table[32];
+        transposeTable(table, pinMasks, count);
+
+        for (int trial = 0; trial < 200; trial++) {
+            uint8_t column[MAX_STRIPS];
+            for (int s = 0; s < MAX_STRIPS; s++)
+                column[s] = rand();
+
+            uint16_t expected[8], actual[8];
+            naiveSlots(expected, column, pinMasks, count);
+            transposeSlots(actual, column, table);
+
+            for (int b = 0; b < 8; b++)
+                REQUIRE(actual[b] == expected[b]);
+        }
+    }
+}
+
+SCENARIO("Single bits land in the right slot and pin", "[transpose]") {
+    const uint16_t pinMasks[MAX_STRIPS] = { 1<<0, 1<<1, 1<<2, 1<<3, 1<<4, 1<<5, 1<<6, 1<<7 };
+    uint16_t table[32];
+    transposeTable(table, pinMasks, MAX_STRIPS);
+
+    uint8_t column[MAX_STRIPS] = { 0x80, 0, 0, 0, 0, 0, 0, 0x01 };
+    uint16_t words[8];
+    transposeSlots(words, column, table);
+
+    CHECK(words[0] == 1<<0);
+    CHECK(words[7] == 1<<7);
+    for (int b = 1; b < 7; b++)
+        CHECK(words[b] == 0);
+}
@@ -0,0 +1,42 @@
+#include "catch.hpp"
+#include "waveform.h"
+
+SCENARIO("Bytes encode to one compare value per bit, MSB first", "[waveform]") {
+    const uint8_t data[] = { 0xA5, 0x00, 0xFF };
+    uint16_t out[24];
+
+    REQUIRE(encodeWaveform(out, 24, data, 3) == 3);
+
+    const uint8_t bitsA5[] = { 1, 0, 1, 0, 0, 1, 0, 1 };
+    for (int i = 0; i < 8; i++)
+        CHECK(out[i] == (bitsA5[i] ? WS2812_T1H : WS2812_T0H));
+    for (int i = 8; i < 16; i++)
+        CHECK(out[i] == WS2812_T0H);
+    for (int i = 16; i < 24; i++)
+        CHECK(out[i] == WS2812_T1H);
+}
+
+SCENARIO("Slots past the end of the data hold the line low", "[waveform]") {
+    const uint8_t data[] = { 0xFF };
+    uint16_t out[32];
+
+    REQUIRE(encodeWaveform(out, 32, data, 1) == 1);
+    for (int i = 8; i < 32; i++)
+        CHECK(out[i] == 0);
+
+    REQUIRE(encodeWaveform(out, 32, data, 0) == 0);
+    for (int i = 0; i < 32; i++)
+        CHECK(out[i] == 0);
+}
+
+SCENARIO("A chunk encodes no more bytes than fit", "[waveform]") {
+    uint8_t data[10] = { 0 };
+    uint16_t out[16];
+
+    CHECK(encodeWaveform(out, 16, data, 10) == 2);
+}
+
+SCENARIO("Compare values fit the bit period", "[waveform]") {
+    CHECK(WS2812_T0H < WS2812_T1H);
+    CHECK(WS2812_T1H < WS2812_PERIOD);
+}
@@ -16,6 +16,8 @@ function Cube(address) {
     this.frameSize = 512;
 
     this.frameBuffer = new ArrayBuffer(this.frameSize);
+    this.commands = null; // pending CommandBatch, sent instead of the frame
+    this.sentSize = 0;
 
     // open connection
     this.ws = new WebSocket(address);
@@ -41,12 +43,66 @@ function Cube(address) {
         var msg = evt.data;
         console.log("got msg: " + msg);
 
-        if(parseInt(msg) == cube.frameSize) {
+        if(parseInt(msg) == cube.sentSize) {
             cube.clearToSend = true;
         }
     };
 }
 
+// drawing command opcodes, see applications/websocket-streaming/draw-commands.h
+var OP_NOP = 0x00,
+    OP_CLEAR = 0x01,
+    OP_VOXEL = 0x02,
+    OP_LINE = 0x03,
+    OP_SPHERE = 0x04,
+    OP_SHELL = 0x05,
+    OP_BOX = 0x06,
+    OP_PLANE = 0x07,
+    OP_PRESENT = 0x08;
+
+var X_AXIS = 0, Y_AXIS = 1, Z_AXIS = 2;
+
+// builds a batch of drawing commands that the cube rasterizes itself
+function CommandBatch() {
+    this.bytes = [];
+}
+
+CommandBatch.prototype = {
+    push: function(op, coords, r, g, b) {
+        this.bytes.push(op);
+
+        for(var i = 0; i < coords.length; i++) {
+            this.bytes.push(Math.floor(clamp(coords[i], -128, 127)) & 0xFF);
+        }
+
+        if(r !== undefined) {
+            this.bytes.push(Math.floor(clamp(r, 0, 255)),
+                Math.floor(clamp(g, 0, 255)),
+                Math.floor(clamp(b, 0, 255)));
+        }
+
+        return this;
+    },
+
+    clear: function(r, g, b) { return this.push(OP_CLEAR, [], r, g, b); },
+    setVoxel: function(x, y, z, r, g, b) { return this.push(OP_VOXEL, [x, y, z], r, g, b); },
+    line: function(x1, y1, z1, x2, y2, z2, r, g, b) { return this.push(OP_LINE, [x1, y1, z1, x2, y2, z2], r, g, b); },
+    sphere: function(x, y, z, radius, r, g, b) { return this.push(OP_SPHERE, [x, y, z, radius], r, g, b); },
+    shell: function(x, y, z, radius, r, g, b) { return this.push(OP_SHELL, [x, y, z, radius], r, g, b); },
+    box: function(x1, y1, z1, x2, y2, z2, r, g, b) { return this.push(OP_BOX, [x1, y1, z1, x2, y2, z2], r, g, b); },
+    plane: function(axis, offset, r, g, b) { return this.push(OP_PLANE, [axis, offset], r, g, b); },
+    present: function() { return this.push(OP_PRESENT, []); },
+
+    // messages of a full frame or more are taken for pixels
+    toArrayBuffer: function(frameSize) {
+        if(this.bytes.length >= frameSize) {
+            throw "Command batch must be smaller than a frame.";
+        }
+
+        return Uint8Array.from(this.bytes).buffer;
+    }
+};
+
 function clamp(x, a, b) {
     return Math.max(a, Math.min(x, b));
 }
@@ -214,7 +270,15 @@ Cube.prototype = {
                 this.onrefresh(this);
             }
 
-            this.ws.send(this.frameBuffer);
+            var message = this.frameBuffer;
+
+            if(this.commands !== null) {
+                message = this.commands.toArrayBuffer(this.frameSize);
+                this.commands = null;
+            }
+
+            this.sentSize = message.byteLength;
+            this.ws.send(message);
             this.clearToSend = false; // must get reply before sending again
 
             setTimeout(function() { cube.refresh(); }, cube.rate);
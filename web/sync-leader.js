@@ -0,0 +1,140 @@
+#!/usr/bin/env node
+
+// Software stand-in for a clock sync leader (see clock-sync.h on the cube).
+// Answers time requests with this machine's microsecond clock and remembers
+// the cubes that ask. A frame sender on this host calls present() after
+// sending each sequenced frame, and every cube that uses this host as its
+// leader (via setLeader) shows that frame at the same moment.
+//
+// With --stream, it sends its own test frames to those cubes at that rate.
+//
+// usage: node sync-leader.js [port] [--stream fps]
+//    or: var leader = require('./sync-leader'); leader.present(sequence);
+
+var dgram = require('dgram');
+
+var SYNC_PORT = 2223;
+var SYNC_REQUEST = 'T'.charCodeAt(0);
+var SYNC_REPLY = 't'.charCodeAt(0);
+var SYNC_PRESENT = 'P'.charCodeAt(0);
+
+// time from present() to the frame being shown, as on a leader cube
+var PRESENT_DELAY = 30000;
+
+// cubes that asked for the time this recently are followers, in ms
+var FOLLOWER_TIMEOUT = 3000;
+
+var STREAMING_PORT = 2222;
+var PIXEL_COUNT = 512;
+var FRAGMENT_SIZE = 256;
+
+var start = process.hrtime();
+var followers = {};
+var socket = dgram.createSocket('udp4');
+
+// microseconds since start, wrapping like the cube's micros()
+function micros() {
+    var t = process.hrtime(start);
+    return (t[0] * 1000000 + Math.floor(t[1] / 1000)) >>> 0;
+}
+
+function liveFollowers() {
+    var now = Date.now();
+    var live = [];
+
+    for(var key in followers) {
+        if(now - followers[key].lastSeen < FOLLOWER_TIMEOUT) {
+            live.push(followers[key]);
+        } else {
+            delete followers[key];
+        }
+    }
+    return live;
+}
+
+// Tells every follower to show frame sequence PRESENT_DELAY from now.
+// Returns the number of followers told.
+function present(sequence) {
+    var msg = new Buffer(7);
+    msg[0] = SYNC_PRESENT;
+    msg.writeUInt16BE(sequence & 0xFFFF, 1);
+    msg.writeUInt32BE((micros() + PRESENT_DELAY) >>> 0, 3);
+
+    var live = liveFollowers();
+    live.forEach(function(f) {
+        socket.send(msg, 0, msg.length, f.port, f.address);
+    });
+    return live.length;
+}
+
+// Sends a sequenced test frame to every follower, then schedules it.
+// Each frame is one color, stepping through the RRRGGGBB palette.
+function streamFrame(sequence) {
+    var count = PIXEL_COUNT / FRAGMENT_SIZE;
+    var live = liveFollowers();
+
+    for(var i = 0; i < count; i++) {
+        var packet = new Buffer(4 + FRAGMENT_SIZE);
+        packet.writeUInt16BE(sequence & 0xFFFF, 0);
+        packet[2] = i;
+        packet[3] = count;
+        packet.fill(sequence & 0xFF, 4);
+
+        live.forEach(function(f) {
+            socket.send(packet, 0, packet.length, STREAMING_PORT, f.address);
+        });
+    }
+    present(sequence);
+}
+
+socket.on('message', function(msg, remote) {
+    var received = micros();
+
+    if(msg.length != 5 || msg[0] != SYNC_REQUEST) {
+        return;
+    }
+
+    var reply = new Buffer(13);
+    reply[0] = SYNC_REPLY;
+    msg.copy(reply, 1, 1, 5);
+    reply.writeUInt32BE(received, 5);
+    reply.writeUInt32BE(micros(), 9);
+
+    socket.send(reply, 0, reply.length, remote.port, remote.address);
+
+    followers[remote.address + ':' + remote.port] = {
+        address: remote.address,
+        port: remote.port,
+        lastSeen: Date.now()
+    };
+});
+
+socket.on('listening', function() {
+    console.log("Sync leader listening on port " + socket.address().port);
+});
+
+exports.present = present;
+exports.followers = liveFollowers;
+exports.micros = micros;
+
+if(require.main === module) {
+    var args = process.argv.slice(2);
+    var streamAt = args.indexOf('--stream');
+    var fps = 0;
+
+    if(streamAt >= 0) {
+        fps = parseFloat(args[streamAt + 1]) || 30;
+        args.splice(streamAt, 2);
+    }
+
+    socket.bind(parseInt(args[0]) || SYNC_PORT);
+
+    if(fps > 0) {
+        var sequence = 0;
+        setInterval(function() {
+            streamFrame(sequence++);
+        }, 1000 / fps);
+    }
+} else {
+    socket.bind(SYNC_PORT);
+}